@@ -33,9 +33,12 @@
 #include <RoboTerraJoystick.h>
 
 #include <RoboTerraRobot.h>
+#include <RoboTerraPeripheralList.h>
+#include <RoboTerraInterruptQueue.h>
 #include <RoboTerraShareData.h>
 
 RoboTerraRobot ROBOT;
 RoboTerraEvent EVENT;
+RoboTerraInterruptQueue ISR_EVENT_QUEUE;
 
 #endif
\ No newline at end of file
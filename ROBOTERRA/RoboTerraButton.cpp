@@ -42,7 +42,9 @@
 #define STATE_DEBOUNCE  3
 
 #define DEVICE_ID       10
-#define MSG_LENGTH      4
+#define DATA_NUM        1
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /***************************** Module Variable *****************************/
 
@@ -58,7 +60,7 @@ void RoboTerraButton::activate() {
     activeButtonNum++;
 
     state = STATE_NORMAL;
-    stateMachineFlag = true; // Let Kernal call runStateMachine()
+    setStateMachineFlag(true); // Let Kernal call runStateMachine()
     
     sendEventMessage(STATE_NORMAL, ACTIVATE, (int)activeButtonNum);
     generateEvent(ACTIVATE, (int)activeButtonNum);
@@ -72,16 +74,13 @@ void RoboTerraButton::deactivate() {
     activeButtonNum--;
 
     state = STATE_INACTIVE;
-    stateMachineFlag = false; // Let Kernal NOT call runStateMachine()
+    setStateMachineFlag(false); // Let Kernal NOT call runStateMachine()
 
     sendEventMessage(STATE_INACTIVE, DEACTIVATE, (int)activeButtonNum);
     generateEvent(DEACTIVATE, (int)activeButtonNum);
 }
 
 void RoboTerraButton::attach(int portID) {
-    // Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
     // Instance variables
     pin = (char)portID;
     pinMode(pin, INPUT);
@@ -92,10 +91,6 @@ void RoboTerraButton::attach(int portID) {
     activate();
 }
 
-bool RoboTerraButton::readStateMachineFlag() {
-    return stateMachineFlag;
-}
-
 /*********************************************************************
  Note 
  When a button level is changed, namely the input pin presents a 
@@ -106,9 +101,9 @@ bool RoboTerraButton::readStateMachineFlag() {
  so that a series of frequent repetitive presses can be recorded. 
 
 *********************************************************************/
-void RoboTerraButton::runStateMachine() {
+void RoboTerraButton::runStateMachine(unsigned long nowMillis) {
     if (state == STATE_DEBOUNCE) {
-        if ((millis() - lastDebounceMillis) > DEBOUNCETIME) {
+        if ((nowMillis - lastDebounceMillis) > DEBOUNCETIME) {
             state = (lastLevel == LEVEL_NORMAL) ? STATE_NORMAL : STATE_DOWN;
         }
     }
@@ -127,7 +122,8 @@ void RoboTerraButton::runStateMachine() {
                 sendEventMessage(STATE_DOWN, BUTTON_PRESS, count);
                 generateEvent(BUTTON_PRESS, count);
             }
-            lastDebounceMillis = millis(); // Record time tick
+            lastDebounceMillis = nowMillis; // Record time tick
+            sleepUntil(lastDebounceMillis + DEBOUNCETIME + 1); // Nothing to do until debounce ends
         }
     }
 } 
@@ -135,24 +131,10 @@ void RoboTerraButton::runStateMachine() {
 /************************** Private Class Functions *************************/
 
 void RoboTerraButton::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = (uint8_t)pin;           // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(pin, stateToSend, typeToSend, firstDataToSend);
 }
 
 void RoboTerraButton::generateEvent(RoboTerraEventType type, int firstData) {
     RoboTerraEvent newEvent(this, type, firstData);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
\ No newline at end of file
@@ -0,0 +1,126 @@
+/****************************************************************************
+ RoboTerraCommandParser.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ This is a part of RoboTerra robotics programming framework.
+ Reads commands the app sends to drive electronics, one frame each:
+
+ 0xFA, Length, Command, Port, data 0 (2 bytes), data 1 (2 bytes), 0xFF
+
+ Length counts Command, Port and data, so it is 2, 4 or 6. Data is
+ little endian, Command is a RoboTerraCommandType and Port the
+ RoboCorePortID of the electronics, 0 for RoboCore itself.
+
+ Bytes are taken from the receive buffer of HardwareSerial one at a time
+ and go straight into their field of the command, no frame is buffered.
+ A frame cut short is dropped after COMMAND_TIMEOUT_MILLIS, and a bad
+ frame is dropped at the first byte that does not fit.
+
+ ****************************************************************************/
+
+#include <RoboTerraCommandParser.h>
+
+#define COMMAND_BEGIN    0xFA
+#define COMMAND_END      0xFF
+#define COMMAND_DATA_MAX 2
+
+#define PARSE_BEGIN      0
+#define PARSE_LENGTH     1
+#define PARSE_BODY       2
+#define PARSE_END        3
+
+/************************** Class Member Functions *************************/ 
+
+RoboTerraCommandParser::RoboTerraCommandParser() {
+	stage = PARSE_BEGIN;
+	bodyLength = 0;
+	position = 0;
+	beginMillis = 0;
+	errorCount = 0;
+}
+
+const RoboTerraCommand* RoboTerraCommandParser::parse(unsigned long nowMillis) {
+	if (stage != PARSE_BEGIN && nowMillis - beginMillis > COMMAND_TIMEOUT_MILLIS) {
+		countError(); // Rest of frame never came
+		stage = PARSE_BEGIN;
+	}
+
+	while (Serial.available() > 0) {
+		uint8_t received = (uint8_t)Serial.read();
+		switch (stage) {
+			case PARSE_BEGIN:
+				restart(received, nowMillis); // Anything else between frames is skipped
+				break;
+
+			case PARSE_LENGTH:
+				if (received < 2 || received > 2 + 2 * COMMAND_DATA_MAX || (received & 1)) {
+					countError();
+					restart(received, nowMillis);
+					break;
+				}
+				bodyLength = received;
+				position = 0;
+				command.dataNum = (received - 2) / 2;
+				stage = PARSE_BODY;
+				break;
+
+			case PARSE_BODY:
+				if (position == 0) {
+					command.type = received;
+				}
+				else if (position == 1) {
+					command.port = received;
+				}
+				else if (position & 1) {
+					int index = (position - 2) / 2;
+					command.data[index] = (int16_t)((uint16_t)command.data[index] | ((uint16_t)received << 8)); // High byte
+				}
+				else {
+					command.data[(position - 2) / 2] = received;
+				}
+				position++;
+				if (position == bodyLength) {
+					stage = PARSE_END;
+				}
+				break;
+
+			case PARSE_END:
+				if (received == COMMAND_END) {
+					stage = PARSE_BEGIN;
+					return &command;
+				}
+				countError();
+				restart(received, nowMillis);
+				break;
+		}
+	}
+	return NULL;
+}
+
+void RoboTerraCommandParser::countError() {
+	if (errorCount != 0xFFFF) {
+		errorCount++;
+	}
+}
+
+unsigned int RoboTerraCommandParser::getErrorCount() {
+	return errorCount;
+}
+
+/************************** Private Class Functions *************************/
+
+void RoboTerraCommandParser::restart(uint8_t received, unsigned long nowMillis) {
+	if (received == COMMAND_BEGIN) {
+		stage = PARSE_LENGTH;
+		beginMillis = nowMillis;
+		command.data[0] = 0;
+		command.data[1] = 0;
+	}
+	else {
+		stage = PARSE_BEGIN;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+/****************************************************************************
+ RoboTerraCommandParser.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Header file for RoboTerraCommandParser.cpp
+
+ ****************************************************************************/
+
+#ifndef RoboTerraCommandParser_h
+#define RoboTerraCommandParser_h
+
+/************************* Incldued Dependencies ********************/
+
+#include <Arduino.h>
+#include <RoboTerraShareData.h> // RoboTerraCommand
+
+/************************* Defined Constant ********************/
+
+#define COMMAND_TIMEOUT_MILLIS 50 // Rest of a frame must arrive within, else it is dropped
+
+/************************* Actual Class Body ********************/
+
+class RoboTerraCommandParser {
+
+public:
+	RoboTerraCommandParser();
+
+	// Called by RoboTerraRoboCore::handleCommands(), reads what Serial received until
+	// a command is whole. NULL if none, command stays valid until next call
+	const RoboTerraCommand* parse(unsigned long nowMillis);
+
+	// Called by RoboTerraRoboCore for a command no electronics takes
+	void countError();
+	unsigned int getErrorCount();
+
+private:
+	uint8_t stage;
+	uint8_t bodyLength;
+	uint8_t position;    // Of next byte in body
+	unsigned long beginMillis;
+	unsigned int errorCount; // Malformed frames and rejected commands
+	RoboTerraCommand command; // Filled in place as bytes are read
+
+	void restart(uint8_t received, unsigned long nowMillis);
+};
+
+#endif
\ No newline at end of file
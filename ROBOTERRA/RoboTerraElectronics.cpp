@@ -19,13 +19,66 @@
  ****************************************************************************/
 
 #include <RoboTerraElectronics.h>
+#include <RoboTerraRobot.h> // Put here NOT in .h is to avoid circular #include
+
+/************************* Forward Declaration ********************/
+
+extern RoboTerraRobot ROBOT; // Global variable
+
+/************************** Class Member Functions *************************/ 
+
+RoboTerraElectronics::RoboTerraElectronics() {
+	isActive = false;
+	stateMachineFlag = false;
+	serviceSlot = -1;
+	wakeMillis = 0;
+	sleepIndex = -1;
+}
 
 void RoboTerraElectronics::activate() {
 	isActive = true;
+	wake(); // Whatever it was waiting for is obsolete
 }
 
 void RoboTerraElectronics::deactivate() {
 	isActive = false;
+	wake();
+}
+
+bool RoboTerraElectronics::readStateMachineFlag() {
+	return stateMachineFlag;
+}
+
+void RoboTerraElectronics::setStateMachineFlag(bool isToRun) {
+	stateMachineFlag = isToRun;
+	if (serviceSlot >= 0) {
+		ROBOT.getRobotController()->updateServiceMask(this);
+	}
+}
+
+unsigned long RoboTerraElectronics::getServiceSlotBit() {
+	if (serviceSlot < 0) {
+		return 0; // Not attached
+	}
+	return 1UL << serviceSlot;
+}
+
+bool RoboTerraElectronics::isAsleep() {
+	return sleepIndex >= 0;
+}
+
+void RoboTerraElectronics::sleepUntil(unsigned long deadline) {
+	ROBOT.getRobotController()->schedulePeripheral(this, deadline);
+}
+
+unsigned long RoboTerraElectronics::getLoopMillis() {
+	return ROBOT.getRobotController()->getLoopMillis();
+}
+
+void RoboTerraElectronics::wake() {
+	if (sleepIndex >= 0) {
+		ROBOT.getRobotController()->unschedulePeripheral(this);
+	}
 }
 
 void RoboTerraElectronics::attach(int portID) {
@@ -34,4 +87,8 @@ void RoboTerraElectronics::attach(int portID) {
 
 void RoboTerraElectronics::attach(int portIDX, int portIDY) {
 	// Implementation in children class	
+}
+
+bool RoboTerraElectronics::handleCommand(const RoboTerraCommand &command) {
+	return false; // Implementation in children class that can be driven by app
 }
\ No newline at end of file
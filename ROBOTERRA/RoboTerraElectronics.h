@@ -17,13 +17,18 @@
 #include <RoboTerraEventSource.h> // Parent class 
 #include <RoboTerraShareData.h>  
 #include <RoboTerraEventQueue.h>  
+#include <RoboTerraInterruptQueue.h>
 
 /************************* Forward Declared Dependencies ********************/
 
+class RoboTerraRoboCore;
+
 /************************* Actual Class Body ********************/
 
 class RoboTerraElectronics : public RoboTerraEventSource {
 
+    friend class RoboTerraRoboCore; // Keeps the sleep heap position
+
 public:
 
     // Called by RoboTerraRoboCore::attach(RoboTerraElectronics &electronics, RoboCorePortID portID)
@@ -32,17 +37,40 @@ public:
     virtual void attach(int portIDX, int portIDY);
 
     // Called by RoboTerraRoboCore::runPeripheralStateMachine()
-    virtual bool readStateMachineFlag() = 0;
-    virtual void runStateMachine() = 0; 
+    bool readStateMachineFlag();
+    virtual void runStateMachine(unsigned long nowMillis) = 0; // millis() sampled once per pass
+    bool isAsleep();
+
+    // Called by RoboTerraPeripheralList, inline to keep its loop call free
+    bool isDueForService() { return stateMachineFlag && sleepIndex < 0 && serviceSlot >= 0; }
+    unsigned long getServiceSlotBit();
+
+    // Called by RoboTerraRoboCore::handleCommands(), false if command is not for this electronics
+    virtual bool handleCommand(const RoboTerraCommand &command);
 
 protected:
 	bool isActive;
 
+    RoboTerraElectronics();
+
 	virtual void activate();
     virtual void deactivate();
+
+    // Let Kernal call runStateMachine() or NOT
+    void setStateMachineFlag(bool isToRun);
+
+    // Let Kernal skip runStateMachine() until deadline in millis()
+    void sleepUntil(unsigned long deadline);
+    void wake();
+
+    // Same millis() as state machines see in current pass of Kernal Loop
+    unsigned long getLoopMillis();
 	
 private:
-  	
+    bool stateMachineFlag;
+    signed char serviceSlot; // Bit in RoboCore service mask, -1 if not attached
+    unsigned long wakeMillis;
+    signed char sleepIndex; // Position in RoboCore sleep heap, -1 if awake
 };
 
 #endif
\ No newline at end of file
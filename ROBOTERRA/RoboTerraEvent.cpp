@@ -21,19 +21,21 @@
 /************************** Class Member Functions *************************/ 
 
 RoboTerraEvent::RoboTerraEvent() {
-	eventSource = NULL;
+	sourceIndex = 0;
 	eventType = EVENT_NULL;
 	eventData[0] = 0;
 	eventData[1] = 0;
+	eventTimestamp = 0;
 }
 
 RoboTerraEvent::RoboTerraEvent(RoboTerraEventSource* source,
 							   RoboTerraEventType type,   
                    			   int data) {
-	eventSource = source;
-	eventType = type;
+	sourceIndex = (source == NULL) ? 0 : source->getSourceIndex();
+	eventType = (unsigned char)type;
 	eventData[0] = data; 
 	eventData[1] = 0;
+	eventTimestamp = 0; // Stamped when published
 }
 
 void RoboTerraEvent::setEventData(int dataToSet, int index) {
@@ -42,24 +44,45 @@ void RoboTerraEvent::setEventData(int dataToSet, int index) {
 	}
 }
 
+void RoboTerraEvent::setTimestamp(unsigned long timestamp) {
+	eventTimestamp = timestamp;
+}
+
+RoboTerraEventSource* RoboTerraEvent::getSource() const {
+	return RoboTerraEventSource::getSourceByIndex(sourceIndex);
+}
+
+unsigned char RoboTerraEvent::getSourceIndex() const {
+	return sourceIndex;
+}
+
 bool RoboTerraEvent::isType(RoboTerraEventType typeToCheck) {
 	return (eventType == typeToCheck);
 }
 
 bool RoboTerraEvent::isFrom(RoboTerraEventSource &source) {
-	return (eventSource == &source);
+	return (sourceIndex != 0 && sourceIndex == source.getSourceIndex());
 }
 
-int RoboTerraEvent::getData() {
+int RoboTerraEvent::getData() const {
 	return eventData[0];
 }
 
-int RoboTerraEvent::getData(int index) {
+int RoboTerraEvent::getData(int index) const {
 	if (index < MAX_EVENT_DATA_NUM) {
 		return eventData[index];
 	}
 }
 
-RoboTerraEventType RoboTerraEvent::type() {
-	return eventType;
+RoboTerraEventType RoboTerraEvent::type() const {
+	return (RoboTerraEventType)eventType;
+}
+
+unsigned long RoboTerraEvent::getTimestamp() const {
+	return eventTimestamp;
+}
+
+unsigned long RoboTerraEvent::getLatency() const {
+	// Unsigned subtraction stays correct across micros() overflow
+	return micros() - eventTimestamp;
 }
\ No newline at end of file
@@ -31,18 +31,25 @@ public:
                    RoboTerraEventType type,  
                    int data);
     void setEventData(int dataToSet, int index);
+    void setTimestamp(unsigned long timestamp);
+    RoboTerraEventSource* getSource() const;
+    unsigned char getSourceIndex() const;
 
     // API Functions released to clients
     bool isType(RoboTerraEventType typeToCheck);
     bool isFrom(RoboTerraEventSource &sourceToCheck);
-    int getData();
-    int getData(int index);
-    RoboTerraEventType type();
+    int getData() const;
+    int getData(int index) const;
+    RoboTerraEventType type() const;
+    unsigned long getTimestamp() const;
+    unsigned long getLatency() const;
 
 private:
-    RoboTerraEventType eventType;
-    RoboTerraEventSource* eventSource;
+    // Packed into 10 bytes on AVR, copied by value through every queue
+    unsigned char sourceIndex; // See RoboTerraEventSource::getSourceByIndex()
+    unsigned char eventType; // RoboTerraEventType fits in one byte
     int eventData[MAX_EVENT_DATA_NUM];
+    unsigned long eventTimestamp; // Full micros(), a blocked handler can leave EVENTs queued for seconds
 };
 
 #endif
\ No newline at end of file
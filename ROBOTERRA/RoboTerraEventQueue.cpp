@@ -7,8 +7,9 @@
 
  Description
  This is a part of RoboTerra robotics programming framework.
- The queue is implemented with a dynamically growing linked 
- list for the sake of saving memory on microcontroller. 
+ The queue is implemented with a statically sized ring buffer whose
+ capacity is chosen per instance at compile time through the template 
+ RoboTerraEventBuffer, so that enqueue and dequeue never touch the heap.
 
  History
  When         Who           Revision    What/Why            
@@ -19,50 +20,83 @@
 
 #include <RoboTerraEventQueue.h>
 
-#define MAX_SIZE 255 // Max RoboTerraEvents allowed in queue to preserve memory
-
 /************************** Class Member Functions *************************/ 
 
-RoboTerraEventQueue::RoboTerraEventQueue() {
-	count = 0;
-	head = tail = NULL;
-}
+RoboTerraEventQueue::RoboTerraEventQueue(RoboTerraEvent *buffer, unsigned char capacity) {
+	cells = buffer;
+	mask = capacity - 1;
+	head = tail = 0;
 
-RoboTerraEventQueue::~RoboTerraEventQueue() {
-	clear();
+	overflowPolicy = OVERFLOW_DROP_NEWEST;
+	highWaterMark = 0;
+	dropCount = 0;
 }
 
 int RoboTerraEventQueue::getSize() {
-	return count;
+	return (unsigned char)(tail - head);
 }
 
 bool RoboTerraEventQueue::isEmpty() {
-	return count == 0;
+	return head == tail;
+}
+
+bool RoboTerraEventQueue::isFull() {
+	return getSize() > mask;
 }
 
 void RoboTerraEventQueue::clear() {
-	while (count > 0) {
-		dequeue();
+	head = tail;
+}
+
+bool RoboTerraEventQueue::enqueue(const RoboTerraEvent &event) {
+	// Make sure queue size not exceed its capacity
+	if (isFull()) {
+		if (overflowPolicy == OVERFLOW_COALESCE && coalesce(event)) {
+			return true; // Merged into a pending EVENT, nothing is lost
+		}
+		dropCount++;
+		if (overflowPolicy == OVERFLOW_DROP_OLDEST) {
+			head++;
+		}
+		else {
+			return false;
+		}
 	}
+
+	cells[tail & mask] = event;
+	tail++;
+
+	if (getSize() > highWaterMark) {
+		highWaterMark = getSize();
+	}
+	return true;
 }
 
-void RoboTerraEventQueue::enqueue(RoboTerraEvent event) {
-	// Make sure queue size not exceed MAX_SIZE
-	if (getSize() == MAX_SIZE) {
+void RoboTerraEventQueue::enqueueFront(const RoboTerraEvent &event) {
+	// Make sure queue size not exceed its capacity
+	if (isFull()) {
+		dropCount++;
 		return;
 	}
 
-	Cell *copy = new Cell;
-	copy->eventInCell = event;
-	copy->pointerToNext = NULL;
-	if (head == NULL) { // Special case when first cell enqueued
-		head = copy;
+	head--;
+	cells[head & mask] = event; // Dequeued next
+
+	if (getSize() > highWaterMark) {
+		highWaterMark = getSize();
 	}
-	else {
-		tail->pointerToNext = copy;
+}
+
+bool RoboTerraEventQueue::coalesce(const RoboTerraEvent &event) {
+	// Overwrite a pending EVENT of same source and type with the newest data
+	for (unsigned char i = head; i != tail; i++) {
+		RoboTerraEvent *pending = &cells[i & mask];
+		if (pending->type() == event.type() && pending->getSourceIndex() == event.getSourceIndex()) {
+			*pending = event;
+			return true;
+		}
 	}
-	tail = copy;
-	count++;
+	return false; // Nothing to coalesce with
 }
 
 RoboTerraEvent RoboTerraEventQueue::dequeue() {
@@ -70,13 +104,35 @@ RoboTerraEvent RoboTerraEventQueue::dequeue() {
 	if (isEmpty()) {
 		return eventToReturn;
 	}
-	Cell *copy = head;
-	eventToReturn = copy->eventInCell;
-	head = copy->pointerToNext;
-	if (head == NULL) { // Special case when last cell dequeued
-		tail = NULL;
-	}
-	delete copy;
-	count--;
+	eventToReturn = cells[head & mask];
+	head++;
 	return eventToReturn;
+}
+
+int RoboTerraEventQueue::dequeue(RoboTerraEvent *buffer, int maxCount) {
+	int count = getSize();
+	if (count > maxCount) {
+		count = maxCount;
+	}
+	for (int i = 0; i < count; i++) {
+		buffer[i] = cells[(unsigned char)(head + i) & mask];
+	}
+	head += count; // Release all cells at once
+	return count;
+}
+
+void RoboTerraEventQueue::setOverflowPolicy(RoboTerraOverflowPolicy policy) {
+	overflowPolicy = (unsigned char)policy;
+}
+
+RoboTerraOverflowPolicy RoboTerraEventQueue::getOverflowPolicy() {
+	return (RoboTerraOverflowPolicy)overflowPolicy;
+}
+
+unsigned int RoboTerraEventQueue::getDropCount() {
+	return dropCount;
+}
+
+int RoboTerraEventQueue::getHighWaterMark() {
+	return highWaterMark;
 }
\ No newline at end of file
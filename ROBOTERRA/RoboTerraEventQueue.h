@@ -22,25 +22,52 @@
 class RoboTerraEventQueue {
 
 public:
-	RoboTerraEventQueue();
-	~RoboTerraEventQueue();
 	int getSize();
 	bool isEmpty();
+	bool isFull();
 	void clear();
-	void enqueue(RoboTerraEvent event);
+	bool enqueue(const RoboTerraEvent &event); // False if EVENT not queued
+	void enqueueFront(const RoboTerraEvent &event);
+	bool coalesce(const RoboTerraEvent &event);
 	RoboTerraEvent dequeue();
+	int dequeue(RoboTerraEvent *buffer, int maxCount); // Return number of EVENTs copied
+
+	// Overflow accounting
+	void setOverflowPolicy(RoboTerraOverflowPolicy policy);
+	RoboTerraOverflowPolicy getOverflowPolicy();
+	unsigned int getDropCount();
+	int getHighWaterMark();
+
+protected:
+	// Called by RoboTerraEventBuffer which owns the actual storage
+	RoboTerraEventQueue(RoboTerraEvent *buffer, unsigned char capacity);
     
 private:
 	// RoboTerraEventQueue implementation data structure
-	struct linkedListCell {
-	  	RoboTerraEvent eventInCell;
-	  	struct linkedListCell *pointerToNext; // Linked list
-	};
-	typedef struct linkedListCell Cell;
-
-    Cell *head; // Point to the cell to be dequeued
-    Cell *tail; // Point to the cell that just enqueued 
-    int count;  // Record how many cells in queue
+	RoboTerraEvent *cells; // Ring buffer of (mask + 1) cells
+	unsigned char mask;    // Capacity - 1, capacity is a power of two
+
+	unsigned char head; // Free running index of the cell to be dequeued
+	unsigned char tail; // Free running index of the cell to be enqueued
+
+	unsigned char overflowPolicy;
+	unsigned char highWaterMark; // Max size ever reached
+	unsigned int dropCount;      // EVENTs lost to overflow, wraps around
+};
+
+/************************* Statically Sized Queue ********************/
+
+template <unsigned char CAPACITY>
+class RoboTerraEventBuffer : public RoboTerraEventQueue {
+
+public:
+	RoboTerraEventBuffer() : RoboTerraEventQueue(storage, CAPACITY) {}
+
+private:
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+	static_assert(CAPACITY <= 128, "Capacity must fit free running unsigned char index");
+
+	RoboTerraEvent storage[CAPACITY];
 };
 
 #endif
\ No newline at end of file
@@ -16,11 +16,310 @@
  ****************************************************************************/
  
 #include <RoboTerraEventSource.h>
+#include <RoboTerraRobot.h> // Put here NOT in .h is to avoid circular #include
+
+/************************* Forward Declaration ********************/
+
+extern RoboTerraRobot ROBOT; // Global variable
+
+/************************* Defined Constant ********************/
+
+#define FRAME_WIRE_FORMAT      0xF6
+#define FRAME_COMPACT_DELTA    0xF7 // Time is varint millis since last compact frame
+#define FRAME_COMPACT_ABSOLUTE 0xF8 // Time is 4 byte millis, after announcement or lost frame
+#define COMPACT_SOURCE_ENTRY   0xFE
+#define COMPACT_STATE_SHIFT    5
+
+static_assert(MAX_EVENT_SOURCE_NUM <= 30, "Compact record keeps source index in 5 bits below 0xFE");
+
+/************************** Static Member Variables *************************/ 
+
+// Zero initialized before any global constructor runs
+RoboTerraEventSource* RoboTerraEventSource::sourceTable[MAX_EVENT_SOURCE_NUM];
+unsigned char RoboTerraEventSource::sourceNum;
+unsigned char RoboTerraEventSource::unindexedSourceNum;
+uint8_t RoboTerraEventSource::frameBuffer[EVENT_FRAME_SIZE + 3];
+uint8_t RoboTerraEventSource::frameLength;
+uint8_t RoboTerraEventSource::frameEventNum;
+uint8_t RoboTerraEventSource::wireFormat; // WIRE_FORMAT_STANDARD
+unsigned long RoboTerraEventSource::announcedSourceMask;
+unsigned long RoboTerraEventSource::lastFrameMillis;
+bool RoboTerraEventSource::isFrameTimeKnown;
+unsigned long RoboTerraEventSource::interruptMicros;
+bool RoboTerraEventSource::isInterruptStamped;
 
 /************************** Class Member Functions *************************/ 
 
-RoboTerraEventQueue* RoboTerraEventSource::getEventQueue() {
-    return sourceEventQueue;
+RoboTerraEventSource::RoboTerraEventSource() {
+	if (sourceNum < MAX_EVENT_SOURCE_NUM - 1) {
+		sourceNum++;
+		sourceIndex = sourceNum;
+		sourceTable[sourceIndex] = this;
+	} else {
+		sourceIndex = 0; // Out of index, EVENTs from it have no source
+		if (unindexedSourceNum != 0xFF) {
+			unindexedSourceNum++; // Reported by RoboTerraRoboCore at launch()
+		}
+	}
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+	clearCycleStats();
+#endif
+}
+
+unsigned char RoboTerraEventSource::getSourceIndex() const {
+	return sourceIndex;
+}
+
+RoboTerraEventSource* RoboTerraEventSource::getSourceByIndex(unsigned char index) {
+	if (index < MAX_EVENT_SOURCE_NUM) {
+		return sourceTable[index];
+	}
+	return NULL;
+}
+
+unsigned char RoboTerraEventSource::getUnindexedSourceNum() {
+	return unindexedSourceNum;
+}
+
+void RoboTerraEventSource::beginInterruptStamp(const RoboTerraEvent &event) {
+    interruptMicros = event.getTimestamp();
+    isInterruptStamped = true;
+}
+
+void RoboTerraEventSource::endInterruptStamp() {
+    isInterruptStamped = false;
+}
+
+void RoboTerraEventSource::flushEventMessages() {
+    if (frameEventNum == 0) {
+        return;
+    }
+    frameBuffer[2 + frameLength] = 0xFF;     // End marker
+    if (wireFormat == WIRE_FORMAT_COMPACT) {
+        // Marker already at index 1, records delimit themselves
+        if (!ROBOT.getTxBuffer()->write(&frameBuffer[1], frameLength + 2, TX_PRIORITY_HIGH)) {
+            announcedSourceMask = 0; // App missed the frame, next is a key frame
+            isFrameTimeKnown = false;
+        }
+    }
+    else {
+        frameBuffer[0] = 0xF0;               // EVENT Message Begin
+        frameBuffer[1] = frameEventNum;      // EVENT Count
+        ROBOT.getTxBuffer()->write(frameBuffer, frameLength + 3, TX_PRIORITY_HIGH);
+    }
+    frameLength = 0;
+    frameEventNum = 0;
+}
+
+void RoboTerraEventSource::setWireFormat(RoboTerraWireFormat format) {
+    if (format == wireFormat) {
+        return;
+    }
+    flushEventMessages(); // Records pending in the old format
+    wireFormat = format;
+    announcedSourceMask = 0; // Next frame is a key frame
+    isFrameTimeKnown = false;
+    announceWireFormat();
+}
+
+RoboTerraWireFormat RoboTerraEventSource::getWireFormat() {
+    return (RoboTerraWireFormat)wireFormat;
+}
+
+void RoboTerraEventSource::announceWireFormat() {
+    uint8_t announceMessage[4];
+    announceMessage[0] = FRAME_WIRE_FORMAT;  // Wire Format Begin
+    announceMessage[1] = 1;                  // Message Length
+    announceMessage[2] = wireFormat;
+    announceMessage[3] = 0xFF;               // End marker
+    ROBOT.getTxBuffer()->write(announceMessage, 4, TX_PRIORITY_HIGH);
+}
+
+void RoboTerraEventSource::publishEvent(const RoboTerraEvent &event) {
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    unsigned long startMicros = micros();
+#endif
+    // All sources share the pre-allocated robot-wide queue, so an EVENT
+    // is copied into its cell once and stays there until dispatched
+    RoboTerraEvent stampedEvent = event;
+    stampedEvent.setTimestamp(getStampMicros());
+    ROBOT.getEventQueue()->enqueue(stampedEvent);
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    recordCycle(CYCLE_GENERATE_EVENT, startMicros);
+#endif
+}
+
+void RoboTerraEventSource::publishEvents(const RoboTerraEvent *events, int count) {
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    unsigned long startMicros = micros();
+#endif
+    // For EVENTs detected in the same pass of a state machine
+    unsigned long timestamp = getStampMicros();
+    for (int i = 0; i < count; i++) {
+        RoboTerraEvent stampedEvent = events[i];
+        stampedEvent.setTimestamp(timestamp);
+        ROBOT.getEventQueue()->enqueue(stampedEvent);
+    }
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    recordCycle(CYCLE_GENERATE_EVENT, startMicros);
+#endif
+}
+
+void RoboTerraEventSource::appendEventRecord(uint8_t deviceID, uint8_t port, uint8_t messageLength, char state, RoboTerraEventType type, int firstData, int secondData) {
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    unsigned long startMicros = micros();
+#endif
+    if (wireFormat == WIRE_FORMAT_COMPACT) {
+        appendCompactRecord(deviceID, port, state, type, firstData, secondData, messageLength > 4);
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+        recordCycle(CYCLE_SEND_MESSAGE, startMicros);
+#endif
+        return;
+    }
+
+    uint8_t recordLength = 3 + messageLength;
+    if (frameLength + recordLength > EVENT_FRAME_SIZE || frameEventNum == 0xFF) {
+        flushEventMessages();
+    }
+
+    uint8_t *record = &frameBuffer[2 + frameLength];
+    record[0] = deviceID;               // EVENT Source Device ID
+    record[1] = port;                   // EVENT Source Port
+    record[2] = messageLength;          // Message Length
+    record[3] = (uint8_t)state;
+    record[4] = (uint8_t)type;
+    record[5] = (uint8_t)firstData;
+    record[6] = (uint8_t)(firstData >> 8);
+    if (messageLength > 4) {
+        record[7] = (uint8_t)secondData;
+        record[8] = (uint8_t)(secondData >> 8);
+    }
+    frameLength += recordLength;
+    frameEventNum++;
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    recordCycle(CYCLE_SEND_MESSAGE, startMicros);
+#endif
+}
+
+/*****************************************************************
+ Compact frame, all multi-byte integers little endian
+
+ 0xF7, varint millis since last compact frame, records, 0xFF
+ 0xF8, 4 byte millis, records, 0xFF    key frame, app forgets sources before it
+
+ record: State << 5 | source index, Type, varint (zigzag data 0 << 1 | 1 if data 1 follows),
+         varint zigzag data 1 (optional)
+ source entry before the first record of a source: 0xFE, source index, Device ID, Port
+
+ Time is the pass that opened the frame. A two port source, e.g. Joystick,
+ is entered with the port of its first record.
+*****************************************************************/
+
+void RoboTerraEventSource::appendCompactRecord(uint8_t deviceID, uint8_t port, char state, RoboTerraEventType type, int firstData, int secondData, bool hasSecondData) {
+    uint8_t record[COMPACT_RECORD_SIZE];
+    uint8_t recordLength = 0;
+    record[recordLength++] = (uint8_t)((state & 0x07) << COMPACT_STATE_SHIFT) | sourceIndex;
+    record[recordLength++] = (uint8_t)type;
+
+    // Zigzag keeps small negative data in one byte, data is 2 bytes on the wire
+    int16_t data = (int16_t)firstData;
+    uint16_t zigzag = ((uint16_t)data << 1) ^ (uint16_t)(data >> 15);
+    recordLength += encodeVarint(&record[recordLength], ((unsigned long)zigzag << 1) | (hasSecondData ? 1 : 0));
+    if (hasSecondData) {
+        data = (int16_t)secondData;
+        zigzag = ((uint16_t)data << 1) ^ (uint16_t)(data >> 15);
+        recordLength += encodeVarint(&record[recordLength], zigzag);
+    }
+
+    // A failed flush forgets announced sources, so decide on the source
+    // entry only after the last flush this record can cause
+    unsigned long sourceBit = 1UL << sourceIndex;
+    bool hasSourceEntry = sourceIndex == 0 || !(announcedSourceMask & sourceBit);
+    if (frameLength + (hasSourceEntry ? 4 : 0) + recordLength > EVENT_FRAME_SIZE) {
+        flushEventMessages();
+        hasSourceEntry = sourceIndex == 0 || !(announcedSourceMask & sourceBit); // Fits an empty frame either way
+    }
+    if (frameEventNum == 0) {
+        unsigned long nowMillis = ROBOT.getRobotController()->getLoopMillis();
+        if (isFrameTimeKnown) {
+            frameBuffer[1] = FRAME_COMPACT_DELTA;
+            frameLength = encodeVarint(&frameBuffer[2], nowMillis - lastFrameMillis);
+        }
+        else {
+            frameBuffer[1] = FRAME_COMPACT_ABSOLUTE;
+            for (int i = 0; i < 4; i++) {
+                frameBuffer[2 + i] = (uint8_t)(nowMillis >> (8 * i));
+            }
+            frameLength = 4;
+        }
+        lastFrameMillis = nowMillis;
+        isFrameTimeKnown = true;
+    }
+
+    if (hasSourceEntry) {
+        frameBuffer[2 + frameLength++] = COMPACT_SOURCE_ENTRY;
+        frameBuffer[2 + frameLength++] = sourceIndex;
+        frameBuffer[2 + frameLength++] = deviceID;
+        frameBuffer[2 + frameLength++] = port;
+    }
+    memcpy(&frameBuffer[2 + frameLength], record, recordLength);
+    frameLength += recordLength;
+    frameEventNum++;
+    announcedSourceMask |= sourceBit;
+}
+
+unsigned long RoboTerraEventSource::getStampMicros() {
+    // Polled sources are stamped with the pass, ISR sources with their ISR
+    if (isInterruptStamped) {
+        return interruptMicros;
+    }
+    return ROBOT.getRobotController()->getLoopMicros();
+}
+
+uint8_t RoboTerraEventSource::encodeVarint(uint8_t *bytes, unsigned long value) {
+    uint8_t length = 0;
+    while (value >= 0x80) {
+        bytes[length++] = (uint8_t)(value | 0x80); // 7 bits a byte, low bits first
+        value >>= 7;
+    }
+    bytes[length++] = (uint8_t)value;
+    return length;
+}
+
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+void RoboTerraEventSource::recordCycle(RoboTerraCycleKind kind, unsigned long startMicros) {
+    unsigned long cycleMicros = micros() - startMicros;
+    CycleStat *stat = &cycleStats[kind];
+    stat->calls++;
+    stat->totalMicros += cycleMicros;
+    if (cycleMicros > stat->maxMicros) {
+        stat->maxMicros = (cycleMicros > 0xFFFF) ? 0xFFFF : cycleMicros;
+    }
+}
+
+unsigned int RoboTerraEventSource::getCycleCalls(RoboTerraCycleKind kind) {
+    return cycleStats[kind].calls;
+}
+
+unsigned long RoboTerraEventSource::getCycleMicros(RoboTerraCycleKind kind) {
+    return cycleStats[kind].totalMicros;
+}
+
+unsigned int RoboTerraEventSource::getMaxCycleMicros(RoboTerraCycleKind kind) {
+    return cycleStats[kind].maxMicros;
+}
+
+void RoboTerraEventSource::clearCycleStats() {
+    for (int i = 0; i < CYCLE_KIND_NUM; i++) {
+        cycleStats[i].calls = 0;
+        cycleStats[i].maxMicros = 0;
+        cycleStats[i].totalMicros = 0;
+    }
+}
+#endif
+
+void RoboTerraEventSource::handleInterruptEvent(RoboTerraEvent &event) {
+	// Implementation in children class
 }
 
 void RoboTerraEventSource::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend) {
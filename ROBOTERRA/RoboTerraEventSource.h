@@ -12,22 +12,80 @@
 
 /************************* Incldued Dependencies ********************/ 
 
+#include <Arduino.h> // uint8_t
 #include <RoboTerraShareData.h>
 
+/************************* Defined Constant ********************/
+
+#define MAX_EVENT_SOURCE_NUM 24 // RoboCore and one per port with spares, index 0 means no source
+#define CYCLE_KIND_NUM       4
+#define EVENT_FRAME_SIZE     32 // Bytes of EVENT records sent as one 0xF0 frame, 3 to 4 records
+#define COMPACT_RECORD_SIZE  12 // Source entry, State, Type and two varint data at most
+
 /************************* Forward Declared Dependencies ********************/ 
 
-class RoboTerraEventQueue;
+class RoboTerraEvent;
+
+/************************* Message Format ********************/
+
+// EVENT message of a kind of source, State and Type then DataNum 2 byte ints
+template <uint8_t DeviceID, uint8_t DataNum>
+struct RoboTerraMessageFormat {
+    static_assert(DataNum >= 1 && DataNum <= 2, "EVENT message carries 1 or 2 data");
+    enum { deviceID = DeviceID, messageLength = 2 + 2 * DataNum };
+};
 
 /************************* Actual Class Body ********************/
 
 class RoboTerraEventSource {
 
 public:  
-	// Called by RoboTerraRoboCore::handlePeripheralEvents()
-    RoboTerraEventQueue* getEventQueue();
+    // Called by RoboTerraRoboCore::handleInterruptEvents()
+    virtual void handleInterruptEvent(RoboTerraEvent &event);
+
+    // Called by RoboTerraEvent to pack its source in one byte
+    unsigned char getSourceIndex() const;
+    static RoboTerraEventSource* getSourceByIndex(unsigned char index);
+
+    // Called by RoboTerraRoboCore to report sources created after the table filled up
+    static unsigned char getUnindexedSourceNum();
+
+    // Called by RoboTerraRoboCore::handleInterruptEvents() around handleInterruptEvent(),
+    // EVENTs published in between are stamped with micros() of the ISR, not of the pass
+    static void beginInterruptStamp(const RoboTerraEvent &event);
+    static void endInterruptStamp();
+
+    // Called by RoboTerraRoboCore once per pass of Kernal Loop
+    static void flushEventMessages();
+
+    // Called by RoboTerraRoboCore::setWireFormat() and launch()
+    static void setWireFormat(RoboTerraWireFormat format);
+    static RoboTerraWireFormat getWireFormat();
+    static void announceWireFormat();
+
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    // Called by RoboTerraRoboCore around calls it makes to this source
+    void recordCycle(RoboTerraCycleKind kind, unsigned long startMicros);
+
+    // Called by RoboTerraRoboCore cycle API
+    unsigned int getCycleCalls(RoboTerraCycleKind kind);
+    unsigned long getCycleMicros(RoboTerraCycleKind kind);
+    unsigned int getMaxCycleMicros(RoboTerraCycleKind kind);
+    void clearCycleStats();
+#endif
 
 protected:
-	RoboTerraEventQueue* sourceEventQueue; // Used by grandson class
+    RoboTerraEventSource();
+
+    // Called by generateEvent() of grandson class
+    void publishEvent(const RoboTerraEvent &event);
+    void publishEvents(const RoboTerraEvent *events, int count);
+
+    // Called by sendEventMessage() of grandson class, Format is its RoboTerraMessageFormat
+    template <typename Format>
+    void encodeEventMessage(uint8_t port, char state, RoboTerraEventType type, int firstData, int secondData = 0) {
+        appendEventRecord(Format::deviceID, port, Format::messageLength, state, type, firstData, secondData);
+    }
 
 	virtual void sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend);
 	virtual void sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend, int secondDataToSend);
@@ -35,7 +93,41 @@ protected:
     virtual void generateEvent(RoboTerraEventType type, int firstData, int secondData);
     
 private:
-    
+    unsigned char sourceIndex;
+
+    // The only encoder of EVENT messages, record is batched with others of the same pass
+    void appendEventRecord(uint8_t deviceID, uint8_t port, uint8_t messageLength, char state, RoboTerraEventType type, int firstData, int secondData);
+    void appendCompactRecord(uint8_t deviceID, uint8_t port, char state, RoboTerraEventType type, int firstData, int secondData, bool hasSecondData);
+    static uint8_t encodeVarint(uint8_t *bytes, unsigned long value);
+    static unsigned long getStampMicros();
+
+    static RoboTerraEventSource* sourceTable[MAX_EVENT_SOURCE_NUM];
+    static unsigned char sourceNum;
+    static unsigned char unindexedSourceNum; // Share index 0, cannot be subscribed to or told apart
+
+    // Pending 0xF0 frame, records from index 2, count and end marker added when sent.
+    // A compact frame is sent from index 1 where its marker goes, see appendCompactRecord()
+    static uint8_t frameBuffer[EVENT_FRAME_SIZE + 3];
+    static uint8_t frameLength;
+    static uint8_t frameEventNum;
+
+    static uint8_t wireFormat;
+    static unsigned long announcedSourceMask; // Sources the app knows Device ID and Port of
+    static unsigned long lastFrameMillis;
+    static bool isFrameTimeKnown;             // False if next compact frame is a key frame
+
+    static unsigned long interruptMicros;     // Stamp of the ISR EVENT being handled
+    static bool isInterruptStamped;
+
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    typedef struct {
+        unsigned int calls;       // Wraps around
+        unsigned int maxMicros;   // Saturates at 0xFFFF
+        unsigned long totalMicros;
+    } CycleStat;
+
+    CycleStat cycleStats[CYCLE_KIND_NUM];
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -61,12 +61,18 @@
 #define STATE_STOP     	4
 
 #define DEVICE_ID       30
-#define MSG_LENGTH      6 
+#define DATA_NUM        2
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /************************ Module Variable ***********************/
 
 static volatile iParameter_t iParameter; // Struct variable used in ISR
 
+/************************ Forward Declaration ********************/
+
+extern RoboTerraInterruptQueue ISR_EVENT_QUEUE; // Global variable
+
 /************************** Class Member Functions *************************/ 
 
 void RoboTerraIRReceiver::activate() {
@@ -77,7 +83,6 @@ void RoboTerraIRReceiver::activate() {
     iParameter.bufferIndex = 0;
 
   	iParameter.state = STATE_IDLE;
-  	iParameter.stateMachineFlag = false; // Let Kernal NOT call runStateMachine()
 
   	sendEventMessage(STATE_IDLE, ACTIVATE, 1, 0);
     generateEvent(ACTIVATE, 1, 0);
@@ -100,7 +105,6 @@ void RoboTerraIRReceiver::deactivate() {
 	iParameter.bufferIndex = 0;
 
 	iParameter.state = STATE_INACTIVE;
-  	iParameter.stateMachineFlag = false; // Let Kernal NOT call runStateMachine()
 
   	sendEventMessage(STATE_INACTIVE, DEACTIVATE, 0, 0);
     generateEvent(DEACTIVATE, 0, 0);
@@ -129,10 +133,8 @@ void RoboTerraIRReceiver::showRawBuffer() {
 }
 
 void RoboTerraIRReceiver::attach(int portID) {
-  	// Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
   	iParameter.pin = (char)portID;
+  	iParameter.source = this;
     pinMode(iParameter.pin, INPUT);
     address = 0;
     value = 0; 
@@ -141,13 +143,14 @@ void RoboTerraIRReceiver::attach(int portID) {
     activate();
 }
 
-bool RoboTerraIRReceiver::readStateMachineFlag() {
-    return iParameter.stateMachineFlag;
+void RoboTerraIRReceiver::runStateMachine(unsigned long nowMillis) {
+    // Left blank intentionally b/c IR receiver is interrupt driven.
+    // Raw messages published by ISR are decoded in handleInterruptEvent()
 }
 
-void RoboTerraIRReceiver::runStateMachine() {
+void RoboTerraIRReceiver::handleInterruptEvent(RoboTerraEvent &event) {
     // The RoboTerraIRReceiver class is interrupt driven when processing raw incoming data.
-    // Kernal runs the state machine whenever raw data is received in buffer for decoding.
+    // ISR publishes an EVENT whenever raw data is received in buffer for decoding.
 
 	if (isActive && (iParameter.state == STATE_STOP)) {	
 		//showRawBuffer(); // debug function
@@ -187,7 +190,6 @@ void RoboTerraIRReceiver::runStateMachine() {
 		// Start to listen to new IR message
 		iParameter.bufferIndex = 0;
 		iParameter.state = STATE_IDLE;
-  		iParameter.stateMachineFlag = false;
 	}
 
 }
@@ -326,29 +328,29 @@ int RoboTerraIRReceiver::getRCLevel(int *offset, int *used, int t1) {
 }
 
 void RoboTerraIRReceiver::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend, int secondDataToSend) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = (uint8_t)iParameter.pin;// EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = (uint8_t)secondDataToSend;
-    eventMessage[10] = (uint8_t)(secondDataToSend >> 8);
-    eventMessage[11] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(iParameter.pin, stateToSend, typeToSend, firstDataToSend, secondDataToSend);
 }
 
 void RoboTerraIRReceiver::generateEvent(RoboTerraEventType type, int firstData, int secondData) {
     RoboTerraEvent newEvent(this, type, firstData);
     newEvent.setEventData(secondData, 1);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
+}
+
+/*****************************************************************
+ Description
+ Publish raw message in buffer to kernal for decoding. Called by ISR
+ only when STATE_STOP is entered.
+
+*****************************************************************/
+
+static void publishRawMessage() {
+	RoboTerraEvent rawMessageEvent(iParameter.source, IR_MESSAGE_RECEIVE, iParameter.bufferIndex);
+	if (!ISR_EVENT_QUEUE.enqueue(rawMessageEvent)) {
+		// Kernal is too busy, drop message and listen to new one
+		iParameter.bufferIndex = 0;
+		iParameter.state = STATE_IDLE;
+	}
 }
 
 /*****************************************************************
@@ -364,6 +366,7 @@ ISR(TIMER2_COMPA_vect) {
 	if (iParameter.bufferIndex >= MAX_RAW_BUFFER_LENGTH) {
 		iParameter.bufferIndex = 0; // Decode return false due to not long enough
 		iParameter.state = STATE_STOP; // Buffer overflow
+		publishRawMessage();
 	} 
 
 	switch(iParameter.state) {
@@ -398,9 +401,8 @@ ISR(TIMER2_COMPA_vect) {
 					// Keep counting ticks on Space
 					// Switch to STATE_STOP indicating ready for decoding
 					iParameter.state = STATE_STOP;
+					publishRawMessage(); // Let Kernal decode
 				}
-				// Set stateMachineFlag so that Kernal would call runStateMachine()
-				iParameter.stateMachineFlag = true;
 			}
 			break;
 		case STATE_STOP: // Waiting
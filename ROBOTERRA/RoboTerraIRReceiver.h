@@ -27,7 +27,7 @@ typedef struct {
     char bufferIndex; // rawBuffer index
 
     char state;
-    bool stateMachineFlag;
+    RoboTerraEventSource* source; // Instance that ISR publishes EVENTs for
 } 
 iParameter_t;
 
@@ -35,6 +35,8 @@ iParameter_t;
 
 class RoboTerraIRReceiver : public RoboTerraElectronics {
 
+    template <typename... T> friend class RoboTerraPeripheralList; // Calls runStateMachine()
+
 public:
     // API Functions released to clients
     void activate();
@@ -48,8 +50,10 @@ protected:
     void attach(int portID);
 
     // Called by RoboTerraRoboCore::runPeripheralStateMachine()
-    bool readStateMachineFlag();
-    void runStateMachine();
+    void runStateMachine(unsigned long nowMillis);
+
+    // Called by RoboTerraRoboCore::handleInterruptEvents()
+    void handleInterruptEvent(RoboTerraEvent &event);
 
 private:
     int address;
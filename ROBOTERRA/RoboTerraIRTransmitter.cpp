@@ -38,7 +38,9 @@
 #define STATE_ACTIVE   	1
 
 #define DEVICE_ID       110
-#define MSG_LENGTH      6 
+#define DATA_NUM        2
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /************************** Class Member Functions *************************/ 
 
@@ -52,7 +54,7 @@ void RoboTerraIRTransmitter::activate() {
     RoboTerraElectronics::activate();
 
     state = STATE_ACTIVE;
-  	stateMachineFlag = false; // Let Kernal NOT call runStateMachine()
+  	setStateMachineFlag(false); // Let Kernal NOT call runStateMachine()
 
   	sendEventMessage(STATE_ACTIVE, ACTIVATE, 1, 0);
     generateEvent(ACTIVATE, 1, 0);
@@ -74,7 +76,7 @@ void RoboTerraIRTransmitter::deactivate() {
     RoboTerraElectronics::deactivate(); // Parent class 
 
     state = STATE_INACTIVE;
-  	stateMachineFlag = false; // Let Kernal NOT call runStateMachine()
+  	setStateMachineFlag(false); // Let Kernal NOT call runStateMachine()
 
   	sendEventMessage(STATE_INACTIVE, DEACTIVATE, 0, 0);
     generateEvent(DEACTIVATE, 0, 0);
@@ -109,9 +111,6 @@ void RoboTerraIRTransmitter::emit(int value, int address) {
 }
 
 void RoboTerraIRTransmitter::attach(int portID) {
-	  // Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
     if (portID == IR_TRAN) {
         pin = portID;
         pinMode(pin, OUTPUT);
@@ -123,11 +122,7 @@ void RoboTerraIRTransmitter::attach(int portID) {
   	
 }
 
-bool RoboTerraIRTransmitter::readStateMachineFlag() {
-    return stateMachineFlag;
-}
-
-void RoboTerraIRTransmitter::runStateMachine() {
+void RoboTerraIRTransmitter::runStateMachine(unsigned long nowMillis) {
     // Intentionally left blank
 }
 
@@ -152,27 +147,11 @@ void RoboTerraIRTransmitter::generateSpace(int microseconds) {
 }
 
 void RoboTerraIRTransmitter::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend, int secondDataToSend) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = (uint8_t)pin;           // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = (uint8_t)secondDataToSend;
-    eventMessage[10] = (uint8_t)(secondDataToSend >> 8);
-    eventMessage[11] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(pin, stateToSend, typeToSend, firstDataToSend, secondDataToSend);
 }
 
 void RoboTerraIRTransmitter::generateEvent(RoboTerraEventType type, int firstData, int secondData) {
     RoboTerraEvent newEvent(this, type, firstData);
     newEvent.setEventData(secondData, 1);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
\ No newline at end of file
@@ -19,6 +19,8 @@
 
 class RoboTerraIRTransmitter : public RoboTerraElectronics {
 
+    template <typename... T> friend class RoboTerraPeripheralList; // Calls runStateMachine()
+
 public:
     // API Functions released to clients
     void activate();
@@ -30,14 +32,12 @@ protected:
     void attach(int portID);
 
     // Called by RoboTerraRoboCore::runPeripheralStateMachine()
-    bool readStateMachineFlag();
-    void runStateMachine();
+    void runStateMachine(unsigned long nowMillis);
     
 private:
     char pin;
 
     char state;
-    bool stateMachineFlag;
 
     void generateMark(int microseconds);
     void generateSpace(int microseconds);
@@ -0,0 +1,72 @@
+/****************************************************************************
+ RoboTerraInterruptQueue.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ This is a part of RoboTerra robotics programming framework.
+ A lock-free single-producer/single-consumer ring buffer through which 
+ interrupt service routines publish EVENTs directly. The producer only
+ writes tail and the consumer only writes head, so the kernel drains it
+ without disabling interrupts. Since ISRs do not nest on AVR, several 
+ ISRs may share the queue as one logical producer.
+
+ ****************************************************************************/
+
+#include <RoboTerraInterruptQueue.h>
+
+#define QUEUE_MASK (INTERRUPT_EVENT_QUEUE_SIZE - 1)
+
+/************************** Class Member Functions *************************/ 
+
+RoboTerraInterruptQueue::RoboTerraInterruptQueue() {
+	head = tail = 0;
+	dropCount = 0;
+	highWaterMark = 0;
+}
+
+bool RoboTerraInterruptQueue::enqueue(const RoboTerraEvent &event) {
+	unsigned char currentTail = tail;
+	unsigned char size = currentTail - head;
+	if (size > QUEUE_MASK) { // Full, only drop newest keeps head owned by consumer
+		dropCount++;
+		return false;
+	}
+
+	cells[currentTail & QUEUE_MASK] = event;
+	cells[currentTail & QUEUE_MASK].setTimestamp(micros()); // Time of the ISR, not of the pass draining it
+	COMPILER_BARRIER(); // Cell must be written before it is published
+	tail = currentTail + 1;
+
+	if (size >= highWaterMark) {
+		highWaterMark = size + 1;
+	}
+	return true;
+}
+
+bool RoboTerraInterruptQueue::dequeue(RoboTerraEvent &event) {
+	unsigned char currentHead = head;
+	if (currentHead == tail) { // Empty
+		return false;
+	}
+
+	COMPILER_BARRIER(); // Cell must not be read before tail is checked
+	event = cells[currentHead & QUEUE_MASK];
+	COMPILER_BARRIER(); // Cell must be read before it is released
+	head = currentHead + 1;
+	return true;
+}
+
+bool RoboTerraInterruptQueue::isEmpty() {
+	return head == tail;
+}
+
+unsigned char RoboTerraInterruptQueue::getDropCount() {
+	return dropCount;
+}
+
+unsigned char RoboTerraInterruptQueue::getHighWaterMark() {
+	return highWaterMark;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+/****************************************************************************
+ RoboTerraInterruptQueue.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Header file for RoboTerraInterruptQueue.cpp 
+
+ ****************************************************************************/
+
+#ifndef RoboTerraInterruptQueue_h
+#define RoboTerraInterruptQueue_h
+
+/************************* Incldued Dependencies ********************/ 
+
+#include <RoboTerraEvent.h>
+
+/************************* Defined Constant ********************/
+
+#define INTERRUPT_EVENT_QUEUE_SIZE 8 // Must be a power of two, no more than 128
+
+// Keep compiler from reordering memory access across this point
+#define COMPILER_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+/************************* Actual Class Body ********************/
+
+class RoboTerraInterruptQueue {
+
+public:
+	RoboTerraInterruptQueue();
+
+	// Called by ISR, the single producer
+	bool enqueue(const RoboTerraEvent &event);
+	
+	// Called by RoboTerraRoboCore::handleInterruptEvents(), the single consumer
+	bool dequeue(RoboTerraEvent &event);
+	bool isEmpty();
+	unsigned char getDropCount();
+	unsigned char getHighWaterMark();
+
+private:
+	RoboTerraEvent cells[INTERRUPT_EVENT_QUEUE_SIZE];
+
+	// One byte indices are read and written atomically on AVR
+	volatile unsigned char head; // Written by consumer only
+	volatile unsigned char tail; // Written by producer only
+	volatile unsigned char dropCount; // Events lost because queue was full
+	volatile unsigned char highWaterMark; // Written by producer only
+};
+
+#endif
\ No newline at end of file
@@ -23,7 +23,9 @@
 #define STATE_DEBOUNCE	2
 
 #define DEVICE_ID		40
-#define MSG_LENGTH		4
+#define DATA_NUM		1
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /***************************** Module Variable *****************************/
 
@@ -39,7 +41,7 @@ void RoboTerraJoystick::activate() {
 	activeJoystickNum++;
 
 	state = STATE_NORMAL;
-	stateMachineFlag = true; // let kernal call runStateMachine()
+	setStateMachineFlag(true); // let kernal call runStateMachine()
 
 	sendEventMessage(STATE_NORMAL, ACTIVATE, (int)activeJoystickNum);
 	generateEvent(ACTIVATE, (int)activeJoystickNum);
@@ -53,7 +55,7 @@ void RoboTerraJoystick::deactivate() {
 	activeJoystickNum--;
 
 	state = STATE_INACTIVE;
-	stateMachineFlag = false;
+	setStateMachineFlag(false);
 
 	sendEventMessage(STATE_INACTIVE, DEACTIVATE, (int)activeJoystickNum);
 	generateEvent(DEACTIVATE, (int)activeJoystickNum);
@@ -67,9 +69,6 @@ void RoboTerraJoystick::attach(int portIDX, int portIDY) {
         return;
     }
 
-    // Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
     // Instance variables
     pinX = (char)portIDX;
     pinY = (char)portIDY;
@@ -85,29 +84,28 @@ void RoboTerraJoystick::attach(int portIDX, int portIDY) {
     activate();
 }
 
-bool RoboTerraJoystick::readStateMachineFlag() {
-	return stateMachineFlag;
-}
-
-void RoboTerraJoystick::runStateMachine() {
+void RoboTerraJoystick::runStateMachine(unsigned long nowMillis) {
     if (state == STATE_DEBOUNCE) {
-        if((millis() - lastDebounceMillis) > DEBOUNCETIME) {
+        if((nowMillis - lastDebounceMillis) > DEBOUNCETIME) {
             state = STATE_NORMAL;
+            RoboTerraEvent updateEvents[2]; // X and Y published together
+            int updateNum = 0;
                 
             xValue = handleRawAnalogValue(analogRead(pinX));
             yValue = handleRawAnalogValue(analogRead(pinY));
             if(xValue != lastXValue) {
                 sendEventMessage(STATE_NORMAL, JOYSTICK_X_UPDATE, xValue);
-                generateEvent(JOYSTICK_X_UPDATE, xValue);
+                updateEvents[updateNum++] = RoboTerraEvent(this, JOYSTICK_X_UPDATE, xValue);
 
                 lastXValue = xValue;
             }
             if(yValue != lastYValue) {
                 sendEventMessage(STATE_NORMAL, JOYSTICK_Y_UPDATE, yValue);
-                generateEvent(JOYSTICK_Y_UPDATE, yValue);
+                updateEvents[updateNum++] = RoboTerraEvent(this, JOYSTICK_Y_UPDATE, yValue);
                     
                 lastYValue = yValue;
             }
+            publishEvents(updateEvents, updateNum);
         }
     }
     else {
@@ -116,7 +114,8 @@ void RoboTerraJoystick::runStateMachine() {
         yValue = handleRawAnalogValue(analogRead(pinY));
         if(xValue != lastXValue || yValue != lastYValue) {
             state = STATE_DEBOUNCE;
-            lastDebounceMillis = millis(); // Record time tick
+            lastDebounceMillis = nowMillis; // Record time tick
+            sleepUntil(lastDebounceMillis + DEBOUNCETIME + 1); // Nothing to do until debounce ends
         }
     } 
 }
@@ -158,24 +157,10 @@ void RoboTerraJoystick::sendEventMessage(char stateToSend, RoboTerraEventType ty
 }
 
 void RoboTerraJoystick::sendEventMessageHelper(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend, char pin) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID    
-    eventMessage[3] = (uint8_t)pin;           // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(pin, stateToSend, typeToSend, firstDataToSend);
 }
 
 void RoboTerraJoystick::generateEvent(RoboTerraEventType type, int firstData) {
     RoboTerraEvent newEvent(this, type, firstData);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
\ No newline at end of file
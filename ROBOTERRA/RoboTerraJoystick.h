@@ -19,6 +19,8 @@
 
 class RoboTerraJoystick : public RoboTerraElectronics {
 
+    template <typename... T> friend class RoboTerraPeripheralList; // Calls runStateMachine()
+
 public:
 	// API Functions released to clients
 	void activate();
@@ -29,8 +31,7 @@ protected:
     void attach(int portIDX, int portIDY);
 
     // Called by RoboTerraRoboCore::runPeripheralStateMachine()
-    bool readStateMachineFlag();
-    void runStateMachine();
+    void runStateMachine(unsigned long nowMillis);
 
 private: 
 	char pinX, pinY;
@@ -41,7 +42,6 @@ private:
 	int lastYValue;
 
 	char state;
-	bool stateMachineFlag;
 
 	// Mapping the raw data to -5 to 5
 	int handleRawAnalogValue(int valueInput);
@@ -33,7 +33,9 @@
 #define STATE_BLINK         3 
 
 #define DEVICE_ID           100
-#define MSG_LENGTH          4
+#define DATA_NUM            1
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /***************************** Module Variable *****************************/
 
@@ -50,7 +52,7 @@ void RoboTerraLED::activate() {
     activeLEDNum++;
 
     state = STATE_OFF;
-    stateMachineFlag = false; // Let kernal NOT call runStateMachine()
+    setStateMachineFlag(false); // Let kernal NOT call runStateMachine()
     
     sendEventMessage(STATE_OFF, ACTIVATE, (int)activeLEDNum);
     generateEvent(ACTIVATE, (int)activeLEDNum);
@@ -65,7 +67,7 @@ void RoboTerraLED::deactivate() {
     activeLEDNum--;
 
     state = STATE_INACTIVE;
-    stateMachineFlag = false; // To let kernal NOT call runStateMachine()
+    setStateMachineFlag(false); // To let kernal NOT call runStateMachine()
 
     sendEventMessage(STATE_INACTIVE, DEACTIVATE, (int)activeLEDNum);
     generateEvent(DEACTIVATE, (int)activeLEDNum);
@@ -80,7 +82,7 @@ void RoboTerraLED::turnOn() {
         onLEDNum++;
 
         state = STATE_ON;
-        stateMachineFlag = false;
+        setStateMachineFlag(false);
         
         sendEventMessage(STATE_ON, LED_TURNON, (int)onLEDNum);
         generateEvent(LED_TURNON, (int)onLEDNum);
@@ -89,7 +91,7 @@ void RoboTerraLED::turnOn() {
         digitalWrite(pin, HIGH);
 
         state = STATE_ON;
-        stateMachineFlag = false;
+        setStateMachineFlag(false);
 
         sendEventMessage(STATE_ON, BLINK_END, intervalCount / 2);
         generateEvent(BLINK_END, intervalCount / 2);
@@ -107,7 +109,7 @@ void RoboTerraLED::turnOff() {
         onLEDNum--;
 
         state = STATE_OFF;
-        stateMachineFlag = false;
+        setStateMachineFlag(false);
 
         sendEventMessage(STATE_OFF, LED_TURNOFF, (int)onLEDNum);
         generateEvent(LED_TURNOFF, (int)onLEDNum);
@@ -117,7 +119,7 @@ void RoboTerraLED::turnOff() {
         onLEDNum--;
 
         state = STATE_OFF;
-        stateMachineFlag = false;
+        setStateMachineFlag(false);
 
         sendEventMessage(STATE_OFF, BLINK_END, intervalCount / 2);
         generateEvent(BLINK_END, intervalCount / 2);
@@ -140,7 +142,7 @@ void RoboTerraLED::toggle() {
             onLEDNum++;
 
             state = STATE_ON;
-            stateMachineFlag = false;
+            setStateMachineFlag(false);
             
             sendEventMessage(STATE_ON, LED_TURNON, (int)onLEDNum);
             generateEvent(LED_TURNON, (int)onLEDNum);
@@ -151,7 +153,7 @@ void RoboTerraLED::toggle() {
             onLEDNum--;
 
             state = STATE_OFF;
-            stateMachineFlag = false;
+            setStateMachineFlag(false);
 
             sendEventMessage(STATE_OFF, LED_TURNOFF, (int)onLEDNum);
             generateEvent(LED_TURNOFF, (int)onLEDNum);
@@ -169,11 +171,12 @@ void RoboTerraLED::slowBlink() {
         isBlinkFinite = false;
         intervalCount = 0;
         blinkTimes = -1; // Make sure STATE_BLINK stays
-        lastMillis = millis(); // Start recording time
+        lastMillis = getLoopMillis(); // Start recording time
+        sleepUntil(lastMillis + blinkInterval + 1); // Next toggle
 
         lastState = state;
         state = STATE_BLINK;
-        stateMachineFlag = true; // Let Kernal call runStateMachine()
+        setStateMachineFlag(true); // Let Kernal call runStateMachine()
 
         sendEventMessage(STATE_BLINK, SLOWBLINK_BEGIN, 0);
         generateEvent(SLOWBLINK_BEGIN, 0); // 0 -> Indefinite blink
@@ -182,6 +185,7 @@ void RoboTerraLED::slowBlink() {
         if (isBlinkFinite == false) {
             if (blinkInterval == FAST_BLINK_INTERVAL) {
                 blinkInterval = SLOW_BLINK_INTERVAL;
+                sleepUntil(lastMillis + blinkInterval + 1);
 
                 sendEventMessage(STATE_BLINK, SLOWBLINK_BEGIN, 0);
                 generateEvent(SLOWBLINK_BEGIN, 0); // 0 -> Indefinite blink
@@ -200,11 +204,12 @@ void RoboTerraLED::fastBlink() {
         isBlinkFinite = false;
         intervalCount = 0;
         blinkTimes = -1; // Make sure STATE_BLINK stays
-        lastMillis = millis(); // Start recording time
+        lastMillis = getLoopMillis(); // Start recording time
+        sleepUntil(lastMillis + blinkInterval + 1); // Next toggle
 
         lastState = state;
         state = STATE_BLINK;
-        stateMachineFlag = true; // Let Kernal call runStateMachine()
+        setStateMachineFlag(true); // Let Kernal call runStateMachine()
         
         sendEventMessage(STATE_BLINK, FASTBLINK_BEGIN, 0);
         generateEvent(FASTBLINK_BEGIN, 0); // 0 -> Indefinite blink        
@@ -213,6 +218,7 @@ void RoboTerraLED::fastBlink() {
         if (isBlinkFinite == false) {
             if (blinkInterval == SLOW_BLINK_INTERVAL) {
                 blinkInterval = FAST_BLINK_INTERVAL;
+                sleepUntil(lastMillis + blinkInterval + 1);
 
                 sendEventMessage(STATE_BLINK, FASTBLINK_BEGIN, 0);
                 generateEvent(FASTBLINK_BEGIN, 0); // 0 -> Indefinite blink  
@@ -231,11 +237,12 @@ void RoboTerraLED::slowBlink(int num) {
         isBlinkFinite = true;
         intervalCount = 0;
         blinkTimes = num;
-        lastMillis = millis(); // Start recording time
+        lastMillis = getLoopMillis(); // Start recording time
+        sleepUntil(lastMillis + blinkInterval + 1); // Next toggle
 
         lastState = state; // Remember which state comming into STATE_BLINK
         state = STATE_BLINK;
-        stateMachineFlag = true; // Let Kernal call runStateMachine()
+        setStateMachineFlag(true); // Let Kernal call runStateMachine()
         
         sendEventMessage(STATE_BLINK, SLOWBLINK_BEGIN, blinkTimes);
         generateEvent(SLOWBLINK_BEGIN, blinkTimes);
@@ -252,11 +259,12 @@ void RoboTerraLED::fastBlink(int num) {
         isBlinkFinite = true;
         intervalCount = 0;
         blinkTimes = num;
-        lastMillis = millis(); // Start recording time
+        lastMillis = getLoopMillis(); // Start recording time
+        sleepUntil(lastMillis + blinkInterval + 1); // Next toggle
         
         lastState = state; // Remember which state comming into STATE_BLINK
         state = STATE_BLINK;
-        stateMachineFlag = true; // Kernal calls runStateMachine()
+        setStateMachineFlag(true); // Kernal calls runStateMachine()
         
         sendEventMessage(STATE_BLINK, FASTBLINK_BEGIN, blinkTimes);
         generateEvent(FASTBLINK_BEGIN, blinkTimes);
@@ -273,7 +281,7 @@ void RoboTerraLED::stopBlink() {
                 digitalWrite(pin, HIGH);
 
                 state = STATE_ON;
-                stateMachineFlag = false; 
+                setStateMachineFlag(false); 
 
                 sendEventMessage(STATE_ON, BLINK_END, intervalCount / 2);
                 generateEvent(BLINK_END, intervalCount / 2);
@@ -282,7 +290,7 @@ void RoboTerraLED::stopBlink() {
                 digitalWrite(pin, LOW);
                 
                 state = STATE_OFF;
-                stateMachineFlag = false;
+                setStateMachineFlag(false);
 
                 sendEventMessage(STATE_OFF, BLINK_END, intervalCount / 2);
                 generateEvent(BLINK_END, intervalCount / 2);
@@ -292,9 +300,6 @@ void RoboTerraLED::stopBlink() {
 }
 
 void RoboTerraLED::attach(int portID) {
-    // Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
     pin = (char)portID;
     pinMode(pin, OUTPUT);
     blinkInterval = 0;
@@ -306,13 +311,42 @@ void RoboTerraLED::attach(int portID) {
     activate();
 }
 
-bool RoboTerraLED::readStateMachineFlag() {
-    return stateMachineFlag;
+bool RoboTerraLED::handleCommand(const RoboTerraCommand &command) {
+    switch (command.type) {
+        case COMMAND_LED_TURN_ON:
+            turnOn();
+            return true;
+        case COMMAND_LED_TURN_OFF:
+            turnOff();
+            return true;
+        case COMMAND_LED_BLINK:
+            if (command.data[0] <= 0) {
+                // Until stopped
+                if (command.data[1] == 0) {
+                    slowBlink();
+                }
+                else {
+                    fastBlink();
+                }
+            }
+            else if (command.data[1] == 0) {
+                slowBlink(command.data[0]);
+            }
+            else {
+                fastBlink(command.data[0]);
+            }
+            return true;
+        case COMMAND_LED_STOP:
+            stopBlink();
+            return true;
+        default:
+            return false;
+    }
 }
 
-void RoboTerraLED::runStateMachine() {
+void RoboTerraLED::runStateMachine(unsigned long nowMillis) {
     if (state == STATE_BLINK) {
-        if (millis() - lastMillis > blinkInterval) {
+        if (nowMillis - lastMillis > blinkInterval) {
             if ((intervalCount * isBlinkFinite) == 2 * blinkTimes) { // Finite blinks finish
                 
                 switch (lastState) {
@@ -320,7 +354,7 @@ void RoboTerraLED::runStateMachine() {
                         digitalWrite(pin, HIGH);
 
                         state = STATE_ON;
-                        stateMachineFlag = false; 
+                        setStateMachineFlag(false); 
 
                         sendEventMessage(STATE_ON, BLINK_END, intervalCount / 2);
                         generateEvent(BLINK_END, intervalCount / 2);
@@ -329,7 +363,7 @@ void RoboTerraLED::runStateMachine() {
                         digitalWrite(pin, LOW);
                         
                         state = STATE_OFF;
-                        stateMachineFlag = false;
+                        setStateMachineFlag(false);
 
                         sendEventMessage(STATE_OFF, BLINK_END, intervalCount / 2);
                         generateEvent(BLINK_END, intervalCount / 2);
@@ -339,7 +373,8 @@ void RoboTerraLED::runStateMachine() {
             else { // Blink Not finished 
                 digitalWrite(pin, !digitalRead(pin));
                 intervalCount++;
-                lastMillis = millis(); // Update recorded time
+                lastMillis = nowMillis; // Update recorded time
+                sleepUntil(lastMillis + blinkInterval + 1);
             }
         }
     }
@@ -348,24 +383,10 @@ void RoboTerraLED::runStateMachine() {
 /************************** Private Class Functions *************************/
 
 void RoboTerraLED::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = (uint8_t)pin;           // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(pin, stateToSend, typeToSend, firstDataToSend);
 }
 
 void RoboTerraLED::generateEvent(RoboTerraEventType type, int firstData) {
     RoboTerraEvent newEvent(this, type, firstData);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
\ No newline at end of file
@@ -19,6 +19,8 @@
 
 class RoboTerraLED : public RoboTerraElectronics {
 
+    template <typename... T> friend class RoboTerraPeripheralList; // Calls runStateMachine()
+
 public:
 	// API Functions released to clients
     void activate();
@@ -37,8 +39,10 @@ protected:
     void attach(int portID);
 
     // Called by RoboTerraRoboCore::runPeripheralStateMachine()
-    bool readStateMachineFlag();
-    void runStateMachine();
+    void runStateMachine(unsigned long nowMillis);
+
+    // Called by RoboTerraRoboCore::handleCommands()
+    bool handleCommand(const RoboTerraCommand &command);
 
 private:
 	char pin;
@@ -50,7 +54,6 @@ private:
 
     char state;
     char lastState;
-    bool stateMachineFlag;  
 
     // Virtual functions in RoboTerraEventSource
     void sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend);
@@ -42,7 +42,9 @@
 #define STATE_DEBOUNCE  3
 
 #define DEVICE_ID       12
-#define MSG_LENGTH      4
+#define DATA_NUM        1
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /***************************** Module Variable *****************************/
 
@@ -58,7 +60,7 @@ void RoboTerraLightSensor::activate() {
     activeLightSensorNum++;
 
     state = STATE_BRIGHT;
-    stateMachineFlag = true; // Let Kernal call runStateMachine()
+    setStateMachineFlag(true); // Let Kernal call runStateMachine()
     
     sendEventMessage(STATE_BRIGHT, ACTIVATE, (int)activeLightSensorNum);
     generateEvent(ACTIVATE, (int)activeLightSensorNum);
@@ -72,16 +74,13 @@ void RoboTerraLightSensor::deactivate() {
     activeLightSensorNum--;
 
     state = STATE_INACTIVE;
-    stateMachineFlag = false; // Let Kernal NOT call runStateMachine()
+    setStateMachineFlag(false); // Let Kernal NOT call runStateMachine()
 
     sendEventMessage(STATE_INACTIVE, DEACTIVATE, (int)activeLightSensorNum);
     generateEvent(DEACTIVATE, (int)activeLightSensorNum);
 }
 
 void RoboTerraLightSensor::attach(int portID) {
-    // Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
     // Instance variables
     pin = (char)portID;
     pinMode(pin, INPUT);
@@ -92,10 +91,6 @@ void RoboTerraLightSensor::attach(int portID) {
     activate();
 }
 
-bool RoboTerraLightSensor::readStateMachineFlag() {
-    return stateMachineFlag;
-}
-
 /*****************************************************************
  Note  
  The darkness here is a relative quantity. Basically, it means that 
@@ -105,9 +100,9 @@ bool RoboTerraLightSensor::readStateMachineFlag() {
  immediately after state transitions.
 
 *****************************************************************/
-void RoboTerraLightSensor::runStateMachine() {
+void RoboTerraLightSensor::runStateMachine(unsigned long nowMillis) {
     if (state == STATE_DEBOUNCE) {
-        if ((millis() - lastDebounceMillis) > DEBOUNCETIME) {
+        if ((nowMillis - lastDebounceMillis) > DEBOUNCETIME) {
             state = (lastLevel == LEVEL_NORMAL) ? STATE_BRIGHT : STATE_DARK;
         }
     }
@@ -126,7 +121,8 @@ void RoboTerraLightSensor::runStateMachine() {
                 sendEventMessage(STATE_DARK, DARK_ENTER, count);
                 generateEvent(DARK_ENTER, count);
             }
-            lastDebounceMillis = millis(); // Record time tick
+            lastDebounceMillis = nowMillis; // Record time tick
+            sleepUntil(lastDebounceMillis + DEBOUNCETIME + 1); // Nothing to do until debounce ends
         }
     }
 } 
@@ -134,24 +130,10 @@ void RoboTerraLightSensor::runStateMachine() {
 /************************** Private Class Functions *************************/
 
 void RoboTerraLightSensor::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = (uint8_t)pin;           // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(pin, stateToSend, typeToSend, firstDataToSend);
 }
 
 void RoboTerraLightSensor::generateEvent(RoboTerraEventType type, int firstData) {
     RoboTerraEvent newEvent(this, type, firstData);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
\ No newline at end of file
@@ -18,6 +18,8 @@
 
 class RoboTerraLightSensor : public RoboTerraElectronics {
 
+    template <typename... T> friend class RoboTerraPeripheralList; // Calls runStateMachine()
+
 public:
     // API Functions released to clients
   	void activate();
@@ -28,8 +30,7 @@ protected:
     void attach(int portID);
 
     // Called by RoboTerraRoboCore::runPeripheralStateMachine()
-    bool readStateMachineFlag();
-    void runStateMachine();
+    void runStateMachine(unsigned long nowMillis);
 
 private:
 	  char pin;
@@ -38,7 +39,6 @@ private:
     int count; // Counting for both enter and leave
     
     char state;
-    bool stateMachineFlag;
 
     // Virtual functions in RoboTerraEventSource
     void sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend);
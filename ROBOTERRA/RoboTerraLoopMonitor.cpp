@@ -0,0 +1,181 @@
+/****************************************************************************
+ RoboTerraLoopMonitor.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ This is a part of RoboTerra robotics programming framework.
+ Watches every pass of Kernal Loop against a budget in micros(). Each
+ state machine, ISR EVENT and EVENT handler is a step, and the longest
+ step of a pass over budget is blamed in a serial frame:
+
+ 0xF5, 11, kind, stage, source index, pass us (4 bytes),
+ step us (4 bytes), 0xFF    all little endian
+
+ kind is 0 for a pass over budget, queued like other reports. Optionally the hardware watchdog
+ runs in interrupt and reset mode. If Kernal Loop gets stuck for the
+ watchdog timeout, the interrupt sends a frame of kind 1 naming the
+ step still running, and the next timeout resets RoboCore.
+
+ Nothing here is compiled unless ROBOCORE_WATCH_LOOP is defined.
+
+ ****************************************************************************/
+
+#include <RoboTerraLoopMonitor.h>
+#include <RoboTerraRobot.h> // Put here NOT in .h is to avoid circular #include
+
+#ifdef ROBOCORE_WATCH_LOOP
+
+#if defined(__AVR__)
+#include <avr/wdt.h>
+#endif
+
+#define MONITOR_REPORT_LENGTH 11
+#define MONITOR_OVERRUN       0
+#define MONITOR_STALL         1
+#define WDT_PRESCALER_MAX     9 // About 8 seconds
+
+/************************* Forward Declaration ********************/
+
+extern RoboTerraRobot ROBOT; // Global variable
+
+/************************** Static Member Variables *************************/
+
+unsigned long RoboTerraLoopMonitor::budgetMicros = 0;
+bool RoboTerraLoopMonitor::isWatchdogOn = false;
+unsigned long RoboTerraLoopMonitor::passStartMicros = 0;
+unsigned long RoboTerraLoopMonitor::stepStartMicros = 0;
+volatile unsigned char RoboTerraLoopMonitor::runningStage = STAGE_KERNAL;
+volatile unsigned char RoboTerraLoopMonitor::runningSource = 0;
+unsigned long RoboTerraLoopMonitor::longestStepMicros = 0;
+unsigned char RoboTerraLoopMonitor::longestStage = STAGE_KERNAL;
+unsigned char RoboTerraLoopMonitor::longestSource = 0;
+unsigned char RoboTerraLoopMonitor::culpritStage = STAGE_KERNAL;
+unsigned char RoboTerraLoopMonitor::culpritSource = 0;
+
+/************************** Class Member Functions *************************/
+
+void RoboTerraLoopMonitor::start(unsigned long budget, unsigned int resetMillis) {
+	budgetMicros = budget;
+	passStartMicros = micros();
+	stepStartMicros = passStartMicros;
+	longestStepMicros = 0;
+
+#if defined(__AVR__)
+	if (resetMillis == 0) {
+		wdt_disable();
+		isWatchdogOn = false;
+		return;
+	}
+
+	// Timeout is 16 ms times a power of two, pick the first not shorter
+	uint8_t prescaler = 0;
+	while ((16UL << prescaler) < resetMillis && prescaler < WDT_PRESCALER_MAX) {
+		prescaler++;
+	}
+	uint8_t prescalerBits = (prescaler & 0x07) | ((prescaler & 0x08) ? _BV(WDP3) : 0);
+
+	cli(); // Timed sequence, 4 cycles to write new setting
+	wdt_reset();
+	WDTCSR = _BV(WDCE) | _BV(WDE);
+	WDTCSR = _BV(WDIE) | _BV(WDE) | prescalerBits; // Interrupt first, reset on next timeout
+	sei();
+	isWatchdogOn = true;
+#endif
+}
+
+bool RoboTerraLoopMonitor::endPass(unsigned long busyEndMicros, unsigned long nextPassMicros) {
+#if defined(__AVR__)
+	if (isWatchdogOn) {
+		WDTCSR |= _BV(WDIE); // Cleared by hardware each time the interrupt runs
+		wdt_reset();
+	}
+#endif
+	if (budgetMicros == 0) {
+		return false;
+	}
+
+	endStep(busyEndMicros);
+	unsigned long passMicros = busyEndMicros - passStartMicros; // Idle sleep excluded
+	bool isOverrun = passMicros > budgetMicros;
+	if (isOverrun) {
+		culpritStage = longestStage;
+		culpritSource = longestSource;
+		sendReport(MONITOR_OVERRUN, longestStage, longestSource, passMicros, longestStepMicros);
+	}
+
+	passStartMicros = nextPassMicros;
+	stepStartMicros = nextPassMicros;
+	longestStepMicros = 0;
+	runningStage = STAGE_KERNAL;
+	runningSource = 0;
+	return isOverrun;
+}
+
+RoboTerraLoopStage RoboTerraLoopMonitor::getCulpritStage() {
+	return (RoboTerraLoopStage)culpritStage;
+}
+
+unsigned char RoboTerraLoopMonitor::getCulpritSource() {
+	return culpritSource;
+}
+
+void RoboTerraLoopMonitor::reportStall() {
+	// Interrupts are off, Serial writes by polling the UART
+	unsigned long now = micros();
+	sendReport(MONITOR_STALL, runningStage, runningSource, now - passStartMicros, now - stepStartMicros);
+}
+
+/************************** Private Class Functions *************************/
+
+void RoboTerraLoopMonitor::endStep(unsigned long now) {
+	unsigned long stepMicros = now - stepStartMicros;
+	if (stepMicros > longestStepMicros) {
+		longestStepMicros = stepMicros;
+		longestStage = runningStage;
+		longestSource = runningSource;
+	}
+	stepStartMicros = now;
+}
+
+void RoboTerraLoopMonitor::sendReport(unsigned char kind, unsigned char stage, unsigned char sourceIndex, unsigned long passMicros, unsigned long stepMicros) {
+	uint8_t reportMessageLength = 3 + MONITOR_REPORT_LENGTH;
+	uint8_t reportMessage[reportMessageLength]; // Loop Monitor Message
+
+	reportMessage[0] = 0xF5;                           // Loop Monitor Begin
+	reportMessage[1] = (uint8_t)MONITOR_REPORT_LENGTH; // Message Length
+	reportMessage[2] = kind;
+	reportMessage[3] = stage;
+	reportMessage[4] = sourceIndex;
+	for (int i = 0; i < 4; i++) {
+		reportMessage[5 + i] = (uint8_t)(passMicros >> (8 * i));
+		reportMessage[9 + i] = (uint8_t)(stepMicros >> (8 * i));
+	}
+	reportMessage[reportMessageLength - 1] = 0xFF;     // End marker
+
+	if (kind == MONITOR_STALL) {
+		// Kernal Loop is stuck, nothing would pump. Complete the frame it
+		// left half sent first, otherwise the app reads garbage
+		ROBOT.getTxBuffer()->finishFrame();
+		Serial.write(reportMessage, reportMessageLength);
+	}
+	else {
+		ROBOT.getTxBuffer()->write(reportMessage, reportMessageLength, TX_PRIORITY_LOW);
+	}
+}
+
+/*****************************************************************
+ Description
+ Watchdog Timeout Interrupt Service Routine
+
+*****************************************************************/
+
+#if defined(__AVR__)
+ISR(WDT_vect) {
+	RoboTerraLoopMonitor::reportStall(); // WDIE is now clear, next timeout resets
+}
+#endif
+
+#endif // ROBOCORE_WATCH_LOOP
\ No newline at end of file
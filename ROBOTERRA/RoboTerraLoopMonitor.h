@@ -0,0 +1,76 @@
+/****************************************************************************
+ RoboTerraLoopMonitor.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Header file for RoboTerraLoopMonitor.cpp
+
+ ****************************************************************************/
+
+#ifndef RoboTerraLoopMonitor_h
+#define RoboTerraLoopMonitor_h
+
+/************************* Incldued Dependencies ********************/
+
+#include <Arduino.h>
+#include <RoboTerraShareData.h> // ROBOCORE_WATCH_LOOP
+
+/************************* Defined Constant ********************/
+
+// Mark the start of a step of Kernal Loop, compiled out unless watched
+#ifdef ROBOCORE_WATCH_LOOP
+#define LOOP_STEP(stage, sourceIndex) RoboTerraLoopMonitor::enterStep(stage, sourceIndex)
+#else
+#define LOOP_STEP(stage, sourceIndex)
+#endif
+
+#ifdef ROBOCORE_WATCH_LOOP
+
+/************************* Actual Class Body ********************/
+
+class RoboTerraLoopMonitor {
+
+public:
+	// Called by RoboTerraRoboCore::watchLoop(), resetMillis 0 leaves watchdog off
+	static void start(unsigned long budget, unsigned int resetMillis);
+
+	// Called by Kernal Loop before each state machine, ISR EVENT or handler
+	static void enterStep(RoboTerraLoopStage stage, unsigned char sourceIndex) {
+		if (budgetMicros != 0) {
+			endStep(micros());
+		}
+		runningStage = stage;
+		runningSource = sourceIndex;
+	}
+
+	// Called by RoboTerraRoboCore::sampleLoopTime(), true if last pass ran over budget
+	static bool endPass(unsigned long busyEndMicros, unsigned long nextPassMicros);
+	static RoboTerraLoopStage getCulpritStage();
+	static unsigned char getCulpritSource();
+
+	// Called by watchdog interrupt while Kernal Loop is stuck
+	static void reportStall();
+
+private:
+	static unsigned long budgetMicros; // 0 if not started
+	static bool isWatchdogOn;
+
+	static unsigned long passStartMicros;
+	static unsigned long stepStartMicros;
+	static volatile unsigned char runningStage; // Read by watchdog interrupt
+	static volatile unsigned char runningSource;
+
+	// Longest step of current pass, blamed if the pass runs over
+	static unsigned long longestStepMicros;
+	static unsigned char longestStage;
+	static unsigned char longestSource;
+	static unsigned char culpritStage;
+	static unsigned char culpritSource;
+
+	static void endStep(unsigned long now);
+	static void sendReport(unsigned char kind, unsigned char stage, unsigned char sourceIndex, unsigned long passMicros, unsigned long stepMicros);
+};
+
+#endif // ROBOCORE_WATCH_LOOP
+
+#endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+/****************************************************************************
+ RoboTerraLoopProfiler.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ This is a part of RoboTerra robotics programming framework.
+ Measures the busy time of every pass of Kernal Loop, from the clock
+ sample of the pass to its idle sleep, and keeps a log2 
+ bucketed histogram plus the longest pass. Each report interval the 
+ window is sent as one serial frame and cleared:
+
+ 0xF3, 40, max pass us (4 bytes), pass count (4 bytes),
+ 16 bucket counts (2 bytes each), 0xFF    all little endian
+
+ Nothing here is compiled unless ROBOCORE_PROFILE_LOOP is defined.
+
+ ****************************************************************************/
+
+#include <RoboTerraLoopProfiler.h>
+#include <RoboTerraRobot.h> // Put here NOT in .h is to avoid circular #include
+
+#ifdef ROBOCORE_PROFILE_LOOP
+
+#define LOOP_REPORT_LENGTH (8 + 2 * LOOP_HISTOGRAM_SIZE)
+
+/************************* Forward Declaration ********************/
+
+extern RoboTerraRobot ROBOT; // Global variable
+
+/************************** Class Member Functions *************************/
+
+RoboTerraLoopProfiler::RoboTerraLoopProfiler() {
+	reportInterval = 0;
+	reset();
+}
+
+void RoboTerraLoopProfiler::start(unsigned long interval) {
+	reportInterval = interval;
+	lastReportMillis = millis();
+	lastPassMicros = micros();
+	reset();
+}
+
+void RoboTerraLoopProfiler::markPass(unsigned long busyEndMicros, unsigned long nextPassMicros) {
+	if (reportInterval == 0) {
+		return;
+	}
+	unsigned long passMicros = busyEndMicros - lastPassMicros; // Work time, not sleep
+	lastPassMicros = nextPassMicros;
+
+	unsigned char bucket = 0;
+	while (passMicros >> bucket && bucket < LOOP_HISTOGRAM_SIZE - 1) {
+		bucket++; // Number of significant bits
+	}
+	if (histogram[bucket] != 0xFFFF) {
+		histogram[bucket]++;
+	}
+	if (passMicros > maxPassMicros) {
+		maxPassMicros = passMicros;
+	}
+	passNum++;
+
+	if ((millis() - lastReportMillis) >= reportInterval) {
+		lastReportMillis += reportInterval;
+		sendReport();
+		reset();
+		lastPassMicros = micros(); // Time spent on report is not a pass
+	}
+}
+
+/************************** Private Class Functions *************************/
+
+void RoboTerraLoopProfiler::reset() {
+	passNum = 0;
+	maxPassMicros = 0;
+	for (int i = 0; i < LOOP_HISTOGRAM_SIZE; i++) {
+		histogram[i] = 0;
+	}
+}
+
+void RoboTerraLoopProfiler::sendReport() {
+	uint8_t reportMessageLength = 3 + LOOP_REPORT_LENGTH;
+	uint8_t reportMessage[reportMessageLength]; // Loop Report Message
+
+	reportMessage[0] = 0xF3;                        // Loop Report Begin
+	reportMessage[1] = (uint8_t)LOOP_REPORT_LENGTH; // Message Length
+	for (int i = 0; i < 4; i++) {
+		reportMessage[2 + i] = (uint8_t)(maxPassMicros >> (8 * i));
+		reportMessage[6 + i] = (uint8_t)(passNum >> (8 * i));
+	}
+	for (int i = 0; i < LOOP_HISTOGRAM_SIZE; i++) {
+		reportMessage[10 + 2 * i] = (uint8_t)histogram[i];
+		reportMessage[11 + 2 * i] = (uint8_t)(histogram[i] >> 8);
+	}
+	reportMessage[reportMessageLength - 1] = 0xFF;  // End marker
+
+	ROBOT.getTxBuffer()->write(reportMessage, reportMessageLength, TX_PRIORITY_LOW);
+}
+
+#endif // ROBOCORE_PROFILE_LOOP
\ No newline at end of file
@@ -0,0 +1,52 @@
+/****************************************************************************
+ RoboTerraLoopProfiler.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Header file for RoboTerraLoopProfiler.cpp
+
+ ****************************************************************************/
+
+#ifndef RoboTerraLoopProfiler_h
+#define RoboTerraLoopProfiler_h
+
+/************************* Incldued Dependencies ********************/
+
+#include <Arduino.h>
+#include <RoboTerraShareData.h> // ROBOCORE_PROFILE_LOOP
+
+#ifdef ROBOCORE_PROFILE_LOOP
+
+/************************* Defined Constant ********************/
+
+#define LOOP_HISTOGRAM_SIZE 16 // Bucket i counts passes of 2^(i-1) to 2^i - 1 us, last one up
+
+/************************* Actual Class Body ********************/
+
+class RoboTerraLoopProfiler {
+
+public:
+	RoboTerraLoopProfiler();
+
+	// Called by RoboTerraRoboCore::profileLoop()
+	void start(unsigned long interval);
+
+	// Called by RoboTerraRoboCore::sampleLoopTime() once per pass, idle sleep excluded
+	void markPass(unsigned long busyEndMicros, unsigned long nextPassMicros);
+
+private:
+	unsigned long reportInterval; // millis(), 0 if not started
+	unsigned long lastReportMillis;
+	unsigned long lastPassMicros;
+
+	unsigned long passNum;
+	unsigned long maxPassMicros;
+	unsigned int histogram[LOOP_HISTOGRAM_SIZE]; // Saturate at 0xFFFF
+
+	void reset();
+	void sendReport();
+};
+
+#endif // ROBOCORE_PROFILE_LOOP
+
+#endif
\ No newline at end of file
@@ -47,7 +47,9 @@
 #define STATE_MOVE      2
 
 #define DEVICE_ID       130
-#define MSG_LENGTH      6
+#define DATA_NUM        2
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /***************************** Module Variable *****************************/
 
@@ -63,7 +65,7 @@ void RoboTerraMotor::activate() {
     activeMotorNum++;
     
     state = STATE_STOP;
-    stateMachineFlag = false; // Let kernal NOT call runStateMachine()
+    setStateMachineFlag(false); // Let kernal NOT call runStateMachine()
 
     sendEventMessage(STATE_STOP, ACTIVATE, (int)activeMotorNum, 0);
     generateEvent(ACTIVATE, (int)activeMotorNum, 0);
@@ -92,7 +94,7 @@ void RoboTerraMotor::deactivate() {
     }
 
     state = STATE_INACTIVE;
-    stateMachineFlag = false; // To let kernal NOT call runStateMachine()
+    setStateMachineFlag(false); // To let kernal NOT call runStateMachine()
 }
 
 void RoboTerraMotor::rotate(int speedToSet) {
@@ -112,7 +114,7 @@ void RoboTerraMotor::rotate(int speedToSet) {
 
     if (state == STATE_STOP) {
         state = STATE_MOVE;
-        stateMachineFlag = false;
+        setStateMachineFlag(false);
 
         speed = (char)speedToSet;
         if (speed > 0) {
@@ -181,7 +183,7 @@ void RoboTerraMotor::pause() {
         analogWrite(motorSpeedPin, 0);
         
         state = STATE_STOP;
-        stateMachineFlag = false;  
+        setStateMachineFlag(false);  
 
         sendEventMessage(STATE_STOP, MOTOR_SPEED_ZERO, 0, (int)direction);
         generateEvent(MOTOR_SPEED_ZERO, 0, (int)direction);
@@ -206,7 +208,7 @@ void RoboTerraMotor::resume() {
         }
         
         state = STATE_MOVE;
-        stateMachineFlag = false;  
+        setStateMachineFlag(false);  
 
         sendEventMessage(STATE_MOVE, MOTOR_SPEED_CHANGE, (int)abs(speed), (int)direction);
         generateEvent(MOTOR_SPEED_CHANGE, (int)abs(speed), (int)direction);
@@ -214,9 +216,6 @@ void RoboTerraMotor::resume() {
 }
 
 void RoboTerraMotor::attach(int portID) {
-    // Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
     if (portID == MOTOR_A_ID) {
         pin = MOTOR_A_ID;
         motorSpeedPin = MOTOR_A_PWM_PIN;
@@ -240,11 +239,15 @@ void RoboTerraMotor::attach(int portID) {
     generateEvent(DEACTIVATE, (int)activeMotorNum, 0);
 }
 
-bool RoboTerraMotor::readStateMachineFlag() {
-    return stateMachineFlag;
+bool RoboTerraMotor::handleCommand(const RoboTerraCommand &command) {
+    if (command.type != COMMAND_MOTOR_ROTATE || command.dataNum < 1) {
+        return false;
+    }
+    rotate(command.data[0]);
+    return true;
 }
 
-void RoboTerraMotor::runStateMachine() {
+void RoboTerraMotor::runStateMachine(unsigned long nowMillis) {
     // Left blank intentionally b/c kernal doesn't need to call this function 
     // The reason is that RoboTerraMotor class doesn't require active polling
 }
@@ -252,27 +255,11 @@ void RoboTerraMotor::runStateMachine() {
 /************************** Private Class Functions *************************/
 
 void RoboTerraMotor::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend, int secondDataToSend) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = (uint8_t)pin;           // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = (uint8_t)secondDataToSend;
-    eventMessage[10] = (uint8_t)(secondDataToSend >> 8);
-    eventMessage[11] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(pin, stateToSend, typeToSend, firstDataToSend, secondDataToSend);
 }
 
 void RoboTerraMotor::generateEvent(RoboTerraEventType type, int firstData, int secondData) {
     RoboTerraEvent newEvent(this, type, firstData);
     newEvent.setEventData(secondData, 1);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
\ No newline at end of file
@@ -19,6 +19,8 @@
 
 class RoboTerraMotor : public RoboTerraElectronics {
 
+    template <typename... T> friend class RoboTerraPeripheralList; // Calls runStateMachine()
+
 public:
     // API Functions released to clients
     void activate();
@@ -33,8 +35,10 @@ protected:
     void attach(int portID);
 
     // Called by RoboTerraRoboCore::runPeripheralStateMachine()
-    bool readStateMachineFlag();
-    void runStateMachine();
+    void runStateMachine(unsigned long nowMillis);
+
+    // Called by RoboTerraRoboCore::handleCommands()
+    bool handleCommand(const RoboTerraCommand &command);
 
 private:
     char pin;
@@ -44,7 +48,6 @@ private:
   	bool direction;
 
   	char state;
-    bool stateMachineFlag;  
 
     // Virtual functions in RoboTerraEventSource
     void sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend, int secondDataToSend);
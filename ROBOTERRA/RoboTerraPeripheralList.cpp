@@ -0,0 +1,26 @@
+/****************************************************************************
+ RoboTerraPeripheralList.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ This is a part of RoboTerra robotics programming framework.
+ Non-template part of the compile-time peripheral registry. Only one
+ registry is in effect, the last one constructed.
+
+ ****************************************************************************/
+
+#include <RoboTerraPeripheralList.h>
+#include <RoboTerraRobot.h> // Put here NOT in .h is to avoid circular #include
+
+/************************* Forward Declaration ********************/
+
+extern RoboTerraRobot ROBOT; // Global variable
+
+/************************** Class Member Functions *************************/
+
+RoboTerraPeripheralRegistry::RoboTerraPeripheralRegistry() {
+    ROBOT.setPeripheralRegistry(this);
+}
\ No newline at end of file
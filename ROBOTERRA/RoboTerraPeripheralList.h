@@ -0,0 +1,80 @@
+/****************************************************************************
+ RoboTerraPeripheralList.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Compile-time registry of the electronics a sketch uses. Declare it
+ 	after the electronics, e.g.
+
+ 	RoboTerraPeripheralList<RoboTerraButton, RoboTerraLED> list(button, led);
+
+ 	Kernal Loop then runs their state machines through one generated
+ 	function with qualified, non-virtual calls the compiler can inline.
+ 	Electronics still have to be attached in attachRoboTerraElectronics().
+ 	Any attached electronics not listed are run through virtual calls.
+
+ ****************************************************************************/
+
+#ifndef RoboTerraPeripheralList_h
+#define RoboTerraPeripheralList_h
+
+/************************* Incldued Dependencies ********************/
+
+#include <RoboTerraElectronics.h>
+#include <RoboTerraLoopMonitor.h> // LOOP_STEP()
+
+/************************* Actual Class Body ********************/
+
+class RoboTerraPeripheralRegistry {
+
+public:
+    // Called by RoboTerraRoboCore::runPeripheralStateMachines()
+    virtual void runStateMachines(unsigned long nowMillis) = 0;
+
+    // Called by RoboTerraRoboCore::launch()
+    virtual unsigned long getServiceSlotMask() = 0;
+
+protected:
+    RoboTerraPeripheralRegistry(); // Registers itself to ROBOT
+};
+
+template <typename... T>
+class RoboTerraPeripheralList;
+
+template <>
+class RoboTerraPeripheralList<> : public RoboTerraPeripheralRegistry {
+
+public:
+    void runStateMachines(unsigned long nowMillis) {}
+    unsigned long getServiceSlotMask() { return 0; }
+};
+
+template <typename Head, typename... Tail>
+class RoboTerraPeripheralList<Head, Tail...> : public RoboTerraPeripheralList<Tail...> {
+
+public:
+    RoboTerraPeripheralList(Head &head, Tail&... tail) : RoboTerraPeripheralList<Tail...>(tail...), peripheral(head) {}
+
+    void runStateMachines(unsigned long nowMillis) {
+        if (peripheral.isDueForService()) {
+            LOOP_STEP(STAGE_STATE_MACHINE, peripheral.getSourceIndex());
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+            unsigned long startMicros = micros();
+#endif
+            peripheral.Head::runStateMachine(nowMillis); // Bound at compile time
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+            peripheral.recordCycle(CYCLE_STATE_MACHINE, startMicros);
+#endif
+        }
+        RoboTerraPeripheralList<Tail...>::runStateMachines(nowMillis);
+    }
+
+    unsigned long getServiceSlotMask() {
+        return peripheral.getServiceSlotBit() | RoboTerraPeripheralList<Tail...>::getServiceSlotMask();
+    }
+
+private:
+    Head &peripheral;
+};
+
+#endif
\ No newline at end of file
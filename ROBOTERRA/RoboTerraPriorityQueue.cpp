@@ -0,0 +1,391 @@
+/****************************************************************************
+ RoboTerraPriorityQueue.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ This is a part of RoboTerra robotics programming framework.
+ A multi-level EVENT queue whose priorities share one pool of cells, each
+ priority being a FIFO list linked through the cells. Any priority can use
+ the whole pool, so a burst of one kind of EVENT is never capped by a fixed
+ share. Each RoboTerraEventType is mapped to a priority through a packed
+ lookup table which clients can reconfigure. Types are numbered by hundreds
+ per kind of source, so the tables hold 32 types of each hundred instead of
+ all 256. Dequeue always serves the highest non-empty priority, so a flood
+ of low priority EVENTs never delays a high one.
+
+ A cell packs an EVENT into 8 bytes instead of 10. Type, source index, the
+ next cell and the timestamp share one long word, the timestamp being kept
+ in 16 us units relative to a base moved along with micros(). An EVENT
+ waiting longer than 131 ms reports 131 ms, it is late either way.
+
+ Note
+ A high priority EVENT waits for at most the high priority EVENTs queued
+ ahead of it, plus up to EVENT_BATCH_SIZE - 1 EVENTs of any priority that
+ Kernal Loop already drained into the batch it is dispatching. The backlog
+ actually observed in the queue is recorded per priority by getMaxBacklog(),
+ multiplied by the longest handler time it bounds the dispatch latency.
+
+ Coalescing is opt-in per RoboTerraEventType. A pending, not yet dispatched
+ EVENT of same source and type is overwritten in place with the newest data
+ instead of queuing another one, so high-rate update EVENTs keep queue 
+ depth constant.
+
+ When the pool is full a new EVENT takes the cell of the oldest EVENT of
+ the lowest priority below its own, so a flood of NORMAL EVENTs can never
+ lock out a HIGH one. With no lower priority EVENT to take, the 
+ RoboTerraOverflowPolicy of the new EVENT's priority decides which EVENT is
+ lost. Each priority counts its drops and records its high-water mark, 
+ which RoboTerraRoboCore reports periodically over serial on request.
+
+ ****************************************************************************/
+
+#include <RoboTerraPriorityQueue.h>
+
+/************************* Defined Constant ********************/
+
+// Layout of QueueCell::packed
+#define CELL_SOURCE_SHIFT   8
+#define CELL_NEXT_SHIFT     13
+#define CELL_AGE_SHIFT      18
+#define CELL_INDEX_MASK     0x1F
+#define CELL_AGE_MIN        (-8192) // 14 bit signed, in units of 16 us
+#define CELL_AGE_MAX        8191
+#define CELL_REBASE_UNITS   4096    // Rebase once new EVENTs get half way to CELL_AGE_MAX
+
+static_assert(QUEUE_CELL_NUM <= CELL_INDEX_MASK + 1, "Cell index must fit 5 bits");
+static_assert(MAX_EVENT_SOURCE_NUM <= CELL_INDEX_MASK + 1, "Source index must fit 5 bits");
+
+/************************** Class Member Functions *************************/ 
+
+RoboTerraPriorityQueue::RoboTerraPriorityQueue() {
+	for (int i = 0; i < PRIORITY_LEVEL_NUM; i++) {
+		overflowPolicy[i] = OVERFLOW_DROP_NEWEST;
+		highWaterMark[i] = 0;
+		dropCount[i] = 0;
+		maxBacklog[i] = 0;
+	}
+	clear();
+	for (int i = 0; i < EVENT_TYPE_INDEX_NUM / 8; i++) {
+		coalesceTable[i] = 0; // No coalescing by default
+	}
+
+	// Default priorities
+	for (int i = 0; i < EVENT_TYPE_INDEX_NUM / 4; i++) {
+		priorityTable[i] = 0x55; // PRIORITY_NORMAL for all 4 types in a byte
+	}
+	setPriority(ROBOCORE_LAUNCH, PRIORITY_HIGH);
+	setPriority(ROBOCORE_TERMINATE, PRIORITY_HIGH);
+	setPriority(ROBOCORE_TIME_UP, PRIORITY_HIGH);
+	setPriority(IR_MESSAGE_REPEAT, PRIORITY_HIGH);
+	setPriority(IR_MESSAGE_RECEIVE, PRIORITY_HIGH);
+	setPriority(JOYSTICK_X_UPDATE, PRIORITY_LOW);
+	setPriority(JOYSTICK_Y_UPDATE, PRIORITY_LOW);
+}
+
+int RoboTerraPriorityQueue::getSize() {
+	return QUEUE_CELL_NUM - freeNum;
+}
+
+bool RoboTerraPriorityQueue::isEmpty() {
+	return freeNum == QUEUE_CELL_NUM;
+}
+
+void RoboTerraPriorityQueue::clear() {
+	for (int i = 0; i < PRIORITY_LEVEL_NUM; i++) {
+		levelSize[i] = 0;
+	}
+	for (unsigned char i = 0; i < QUEUE_CELL_NUM; i++) {
+		cells[i].packed = 0;
+		setNext(i, i + 1); // Last one is never followed, freeNum tells
+	}
+	freeHead = 0;
+	freeNum = QUEUE_CELL_NUM;
+}
+
+void RoboTerraPriorityQueue::enqueue(const RoboTerraEvent &event) {
+	unsigned char priority = getPriority(event.type());
+	if (isCoalescing(event.type()) && coalesce(priority, event)) {
+		return;
+	}
+
+	// Make sure queue size not exceed its capacity
+	for (unsigned char i = PRIORITY_LEVEL_NUM - 1; freeNum == 0 && i > priority; i--) {
+		if (levelSize[i] != 0) {
+			dropCount[i]++; // Lower priority gives way
+			freeCell(takeFront(i));
+		}
+	}
+	if (freeNum == 0) {
+		if (overflowPolicy[priority] == OVERFLOW_COALESCE && coalesce(priority, event)) {
+			return; // Merged into a pending EVENT, nothing is lost
+		}
+		dropCount[priority]++;
+		if (overflowPolicy[priority] == OVERFLOW_DROP_OLDEST && levelSize[priority] != 0) {
+			freeCell(takeFront(priority));
+		}
+		else {
+			return;
+		}
+	}
+
+	unsigned char cell = freeHead;
+	freeHead = getNext(cell);
+	freeNum--;
+	store(cell, event);
+	if (levelSize[priority] == 0) {
+		levelHead[priority] = cell;
+	}
+	else {
+		setNext(levelTail[priority], cell);
+	}
+	levelTail[priority] = cell;
+	levelSize[priority]++;
+	if (levelSize[priority] > highWaterMark[priority]) {
+		highWaterMark[priority] = levelSize[priority];
+	}
+
+	// EVENTs of same or higher priority are all dispatched before this one
+	unsigned char backlog = 0;
+	for (int i = 0; i <= priority; i++) {
+		backlog += levelSize[i];
+	}
+	backlog--; // Not including itself
+	if (backlog > maxBacklog[priority]) {
+		maxBacklog[priority] = backlog;
+	}
+}
+
+void RoboTerraPriorityQueue::enqueue(const RoboTerraEvent *events, int count) {
+	for (int i = 0; i < count; i++) {
+		enqueue(events[i]); // Each EVENT may go to a different priority
+	}
+}
+
+void RoboTerraPriorityQueue::enqueueFront(const RoboTerraEvent &event) {
+	unsigned char priority = getPriority(event.type());
+
+	// Make sure queue size not exceed its capacity
+	if (freeNum == 0) {
+		dropCount[priority]++;
+		return;
+	}
+
+	unsigned char cell = freeHead;
+	freeHead = getNext(cell);
+	freeNum--;
+	store(cell, event);
+	if (levelSize[priority] == 0) {
+		levelTail[priority] = cell;
+	}
+	else {
+		setNext(cell, levelHead[priority]);
+	}
+	levelHead[priority] = cell; // Dequeued next
+	levelSize[priority]++;
+	if (levelSize[priority] > highWaterMark[priority]) {
+		highWaterMark[priority] = levelSize[priority];
+	}
+}
+
+RoboTerraEvent RoboTerraPriorityQueue::dequeue() {
+	for (unsigned char i = 0; i < PRIORITY_LEVEL_NUM; i++) {
+		if (levelSize[i] != 0) {
+			unsigned char cell = takeFront(i);
+			RoboTerraEvent eventToReturn = load(cell);
+			freeCell(cell);
+			return eventToReturn;
+		}
+	}
+	RoboTerraEvent eventToReturn; // Empty
+	return eventToReturn;
+}
+
+int RoboTerraPriorityQueue::dequeue(RoboTerraEvent *buffer, int maxCount) {
+	// A higher priority EVENT arriving meanwhile waits for the rest of the
+	// batch, so the batch size adds to its worst case backlog
+	int count = 0;
+	for (unsigned char i = 0; i < PRIORITY_LEVEL_NUM; i++) {
+		while (levelSize[i] != 0 && count < maxCount) {
+			unsigned char cell = takeFront(i);
+			buffer[count++] = load(cell);
+			freeCell(cell);
+		}
+	}
+	return count;
+}
+void RoboTerraPriorityQueue::setPriority(RoboTerraEventType type, RoboTerraEventPriority priority) {
+	if (priority >= PRIORITY_LEVEL_NUM) {
+		return;
+	}
+	unsigned char index = getTypeIndex(type);
+	if (index >= EVENT_TYPE_INDEX_NUM) {
+		return;
+	}
+	unsigned char shift = (index & 0x03) * 2;
+	priorityTable[index >> 2] &= ~(0x03 << shift);
+	priorityTable[index >> 2] |= (priority << shift);
+}
+
+RoboTerraEventPriority RoboTerraPriorityQueue::getPriority(RoboTerraEventType type) {
+	unsigned char index = getTypeIndex(type);
+	if (index >= EVENT_TYPE_INDEX_NUM) {
+		return PRIORITY_NORMAL;
+	}
+	return (RoboTerraEventPriority)((priorityTable[index >> 2] >> ((index & 0x03) * 2)) & 0x03);
+}
+
+int RoboTerraPriorityQueue::getMaxBacklog(RoboTerraEventPriority priority) {
+	if (priority >= PRIORITY_LEVEL_NUM) {
+		return 0;
+	}
+	return maxBacklog[priority];
+}
+
+void RoboTerraPriorityQueue::setCoalescing(RoboTerraEventType type, bool isCoalesced) {
+	unsigned char index = getTypeIndex(type);
+	if (index >= EVENT_TYPE_INDEX_NUM) {
+		return;
+	}
+	if (isCoalesced) {
+		coalesceTable[index >> 3] |= (1 << (index & 0x07));
+	}
+	else {
+		coalesceTable[index >> 3] &= ~(1 << (index & 0x07));
+	}
+}
+
+bool RoboTerraPriorityQueue::isCoalescing(RoboTerraEventType type) {
+	unsigned char index = getTypeIndex(type);
+	if (index >= EVENT_TYPE_INDEX_NUM) {
+		return false;
+	}
+	return (coalesceTable[index >> 3] >> (index & 0x07)) & 0x01;
+}
+
+void RoboTerraPriorityQueue::setOverflowPolicy(RoboTerraEventPriority priority, RoboTerraOverflowPolicy policy) {
+	if (priority >= PRIORITY_LEVEL_NUM) {
+		return;
+	}
+	overflowPolicy[priority] = (unsigned char)policy;
+}
+
+unsigned int RoboTerraPriorityQueue::getDropCount(RoboTerraEventPriority priority) {
+	if (priority >= PRIORITY_LEVEL_NUM) {
+		return 0;
+	}
+	return dropCount[priority];
+}
+
+int RoboTerraPriorityQueue::getHighWaterMark(RoboTerraEventPriority priority) {
+	if (priority >= PRIORITY_LEVEL_NUM) {
+		return 0;
+	}
+	return highWaterMark[priority];
+}
+
+/************************** Private Class Functions *************************/
+
+unsigned char RoboTerraPriorityQueue::getTypeIndex(RoboTerraEventType type) {
+	unsigned char group = (unsigned char)type / 100;
+	unsigned char offset = (unsigned char)type % 100;
+	if (offset >= EVENT_TYPE_GROUP_SIZE) {
+		return EVENT_TYPE_INDEX_NUM; // Not tracked, acts as NORMAL and not coalesced
+	}
+	return group * EVENT_TYPE_GROUP_SIZE + offset;
+}
+
+unsigned char RoboTerraPriorityQueue::getNext(unsigned char cell) {
+	return (cells[cell].packed >> CELL_NEXT_SHIFT) & CELL_INDEX_MASK;
+}
+
+void RoboTerraPriorityQueue::setNext(unsigned char cell, unsigned char next) {
+	cells[cell].packed &= ~((unsigned long)CELL_INDEX_MASK << CELL_NEXT_SHIFT);
+	cells[cell].packed |= (unsigned long)(next & CELL_INDEX_MASK) << CELL_NEXT_SHIFT;
+}
+
+void RoboTerraPriorityQueue::store(unsigned char cell, const RoboTerraEvent &event) {
+	unsigned long now = micros();
+	if (freeNum == QUEUE_CELL_NUM - 1) {
+		baseMicros = now; // First cell in use, no age to keep
+	}
+	else if ((now - baseMicros) >> 4 >= CELL_REBASE_UNITS) {
+		rebase(now);
+	}
+
+	long age = (long)(event.getTimestamp() - baseMicros) >> 4;
+	if (age < CELL_AGE_MIN) {
+		age = CELL_AGE_MIN;
+	}
+	else if (age > CELL_AGE_MAX) {
+		age = CELL_AGE_MAX;
+	}
+
+	cells[cell].packed = (unsigned long)(unsigned char)event.type()
+	                   | (unsigned long)(event.getSourceIndex() & CELL_INDEX_MASK) << CELL_SOURCE_SHIFT
+	                   | (unsigned long)age << CELL_AGE_SHIFT; // Next cell set by caller
+	for (int i = 0; i < MAX_EVENT_DATA_NUM; i++) {
+		cells[cell].data[i] = event.getData(i);
+	}
+}
+
+RoboTerraEvent RoboTerraPriorityQueue::load(unsigned char cell) {
+	unsigned long packed = cells[cell].packed;
+	RoboTerraEvent eventToReturn(RoboTerraEventSource::getSourceByIndex((packed >> CELL_SOURCE_SHIFT) & CELL_INDEX_MASK),
+	                             (RoboTerraEventType)(packed & 0xFF),
+	                             cells[cell].data[0]);
+	for (int i = 1; i < MAX_EVENT_DATA_NUM; i++) {
+		eventToReturn.setEventData(cells[cell].data[i], i);
+	}
+	long age = (long)packed >> CELL_AGE_SHIFT; // Arithmetic shift keeps the sign
+	eventToReturn.setTimestamp(baseMicros + ((unsigned long)age << 4));
+	return eventToReturn;
+}
+
+void RoboTerraPriorityQueue::rebase(unsigned long now) {
+	// Move the base up to now, ages of waiting EVENTs shrink accordingly
+	unsigned long units = (now - baseMicros) >> 4;
+	for (unsigned char i = 0; i < PRIORITY_LEVEL_NUM; i++) {
+		unsigned char cell = levelHead[i];
+		for (unsigned char n = 0; n < levelSize[i]; n++) {
+			long age = (long)cells[cell].packed >> CELL_AGE_SHIFT;
+			age = (age - CELL_AGE_MIN < (long)units) ? CELL_AGE_MIN : age - (long)units;
+			cells[cell].packed = (cells[cell].packed & ((1UL << CELL_AGE_SHIFT) - 1))
+			                   | (unsigned long)age << CELL_AGE_SHIFT;
+			cell = getNext(cell);
+		}
+	}
+	baseMicros += units << 4;
+}
+
+bool RoboTerraPriorityQueue::coalesce(unsigned char priority, const RoboTerraEvent &event) {
+	// Overwrite a pending EVENT of same source and type with the newest data
+	unsigned char cell = levelHead[priority];
+	for (unsigned char n = 0; n < levelSize[priority]; n++) {
+		unsigned char next = getNext(cell);
+		unsigned long packed = cells[cell].packed;
+		if ((unsigned char)(packed & 0xFF) == (unsigned char)event.type() &&
+		    ((packed >> CELL_SOURCE_SHIFT) & CELL_INDEX_MASK) == event.getSourceIndex()) {
+			store(cell, event);
+			setNext(cell, next);
+			return true;
+		}
+		cell = next;
+	}
+	return false; // Nothing to coalesce with
+}
+
+unsigned char RoboTerraPriorityQueue::takeFront(unsigned char priority) {
+	unsigned char cell = levelHead[priority];
+	levelHead[priority] = getNext(cell);
+	levelSize[priority]--;
+	return cell;
+}
+
+void RoboTerraPriorityQueue::freeCell(unsigned char cell) {
+	setNext(cell, freeHead);
+	freeHead = cell;
+	freeNum++;
+}
\ No newline at end of file
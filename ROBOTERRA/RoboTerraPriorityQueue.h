@@ -0,0 +1,91 @@
+/****************************************************************************
+ RoboTerraPriorityQueue.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Header file for RoboTerraPriorityQueue.cpp 
+
+ ****************************************************************************/
+
+#ifndef RoboTerraPriorityQueue_h
+#define RoboTerraPriorityQueue_h
+
+/************************* Incldued Dependencies ********************/ 
+
+#include <RoboTerraEvent.h>
+#include <RoboTerraShareData.h>
+
+/************************* Defined Constant ********************/
+
+#define PRIORITY_LEVEL_NUM          3
+#define QUEUE_CELL_NUM              32 // Shared by all priorities, 8 bytes each, no more than 32
+#define EVENT_BATCH_SIZE            4  // Max EVENTs drained by Kernal Loop in one call
+#define EVENT_TYPE_GROUP_SIZE       32 // Types used per hundred, e.g. 100 - 131
+#define EVENT_TYPE_INDEX_NUM        96 // Hundreds 0, 1 and 2
+
+/************************* Actual Class Body ********************/
+
+class RoboTerraPriorityQueue {
+
+public:
+	RoboTerraPriorityQueue();
+	int getSize();
+	bool isEmpty();
+	void clear();
+	void enqueue(const RoboTerraEvent &event);
+	void enqueue(const RoboTerraEvent *events, int count);
+	void enqueueFront(const RoboTerraEvent &event);
+	RoboTerraEvent dequeue(); // Highest priority first, FIFO within a priority
+	int dequeue(RoboTerraEvent *buffer, int maxCount); // Same order, return number of EVENTs copied
+
+	void setPriority(RoboTerraEventType type, RoboTerraEventPriority priority);
+	RoboTerraEventPriority getPriority(RoboTerraEventType type);
+	int getMaxBacklog(RoboTerraEventPriority priority);
+	void setCoalescing(RoboTerraEventType type, bool isCoalesced);
+	bool isCoalescing(RoboTerraEventType type);
+
+	// Overflow accounting per priority
+	void setOverflowPolicy(RoboTerraEventPriority priority, RoboTerraOverflowPolicy policy);
+	unsigned int getDropCount(RoboTerraEventPriority priority);
+	int getHighWaterMark(RoboTerraEventPriority priority);
+
+private:
+	// An EVENT packed into 8 bytes, timestamp kept as age relative to baseMicros
+	typedef struct {
+		unsigned long packed; // Type, source index, next cell and age, see CELL_* in .cpp
+		int data[MAX_EVENT_DATA_NUM];
+	} QueueCell;
+
+	QueueCell cells[QUEUE_CELL_NUM];
+	unsigned long baseMicros; // Ages of all cells count back from here
+
+	// One FIFO list of cells per priority plus the free list, linked by cell index
+	unsigned char levelHead[PRIORITY_LEVEL_NUM];
+	unsigned char levelTail[PRIORITY_LEVEL_NUM];
+	unsigned char levelSize[PRIORITY_LEVEL_NUM];
+	unsigned char freeHead;
+	unsigned char freeNum;
+
+	unsigned char priorityTable[EVENT_TYPE_INDEX_NUM / 4]; // 2 bits per type index
+	unsigned char coalesceTable[EVENT_TYPE_INDEX_NUM / 8]; // 1 bit per type index
+	static unsigned char getTypeIndex(RoboTerraEventType type);
+
+	unsigned char overflowPolicy[PRIORITY_LEVEL_NUM];
+	unsigned char highWaterMark[PRIORITY_LEVEL_NUM]; // Max cells a priority ever held
+	unsigned int dropCount[PRIORITY_LEVEL_NUM];      // EVENTs lost to overflow, wraps around
+
+	// Max EVENTs queued ahead of a newly enqueued one, i.e. the number of
+	// handler calls it has to wait for unless higher priority ones arrive
+	unsigned char maxBacklog[PRIORITY_LEVEL_NUM];
+
+	unsigned char getNext(unsigned char cell);
+	void setNext(unsigned char cell, unsigned char next);
+	void store(unsigned char cell, const RoboTerraEvent &event);
+	RoboTerraEvent load(unsigned char cell);
+	void rebase(unsigned long now);
+	bool coalesce(unsigned char priority, const RoboTerraEvent &event);
+	unsigned char takeFront(unsigned char priority); // Cell leaves the list, not yet freed
+	void freeCell(unsigned char cell);
+};
+
+#endif
\ No newline at end of file
@@ -25,23 +25,46 @@
  
 #include <RoboTerraRoboCore.h>
 #include <RoboTerraRobot.h> // Put here NOT in .h is to avoid circular #include
+#include <RoboTerraPeripheralList.h>
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#endif
 
 #define DEVICE_ID  1
-#define MSG_LENGTH 4
+#define DATA_NUM   1
+#define QUEUE_REPORT_LENGTH 14 // 4 bytes per priority level and 2 for ISR queue
+#define CYCLE_REPORT_LENGTH (2 + 8 * CYCLE_KIND_NUM) // Source index, port and 8 bytes per kind
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
+typedef RoboTerraMessageFormat<DEVICE_ID, 2> TimerMessageFormat; // ROBOCORE_TIME_UP adds timerID
 
 /************************* Forward Declaration ********************/
 
 extern RoboTerraRobot ROBOT; // Global variable
+extern RoboTerraInterruptQueue ISR_EVENT_QUEUE; // Global variable
 
 /************************** Class Member Functions *************************/ 
 
 RoboTerraRoboCore::RoboTerraRoboCore() {
 	state = STATE_COMMENCE;
 
-	// Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
 	numOfPortInUse = 0;
+	numOfPeripheral = 0;
+	serviceMask = 0;
+	registrySlotMask = 0;
+	loopMillis = 0;
+	loopMicros = 0;
+	sleepNum = 0;
+	controlLoopNum = 0;
+	isRunningControlLoops = false;
+	idleMicros = 0;
+	idleStatsMicros = 0;
+	idleSinceMicros = 0;
+	isIdling = false;
+	reportInterval = 0;
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+	cycleReportSlot = PORT_NUM; // Not reporting
+#endif
 	ROBOT.equip(this); // Every instance constuctor would call
 }
 
@@ -50,6 +73,8 @@ void RoboTerraRoboCore::attach(RoboTerraElectronics &electronics, RoboCorePortID
 		return;
 	}
 
+	sampleLoopTime(); // Stamp ACTIVATE EVENTs before Kernal Loop runs
+	assignServiceSlot(electronics); // Before attach() activates it
 	electronics.attach(portID); // Pass by reference
 	portsInUse[numOfPortInUse].ptToElectronicsOnPort = &electronics;
 	portsInUse[numOfPortInUse].portID = portID;
@@ -61,6 +86,8 @@ void RoboTerraRoboCore::attach(RoboTerraElectronics &electronics, RoboCorePortID
 		return;
 	}
 
+	sampleLoopTime(); // Stamp ACTIVATE EVENTs before Kernal Loop runs
+	assignServiceSlot(electronics); // Before attach() activates it
 	electronics.attach(portIDX, portIDY); // Pass by reference
 	portsInUse[numOfPortInUse].ptToElectronicsOnPort = &electronics;
 	portsInUse[numOfPortInUse].portID = portIDX;
@@ -75,9 +102,32 @@ void RoboTerraRoboCore::launch() {
 		return;
 	}
 	RoboTerraBrain::launch();
+	sampleLoopTime();
+	idleStatsMicros = loopMicros;
+
+	// Slots of listed electronics are run by the registry, not by mask
+	if (ROBOT.getPeripheralRegistry() != NULL) {
+		registrySlotMask = ROBOT.getPeripheralRegistry()->getServiceSlotMask();
+	}
 
+	// App may have connected after attach(), tell it how to read what follows
+	if (RoboTerraEventSource::getWireFormat() != WIRE_FORMAT_STANDARD) {
+		RoboTerraEventSource::announceWireFormat();
+	}
 	sendEventMessage(STATE_OPERATE, ROBOCORE_LAUNCH, numOfPortInUse);
-	generateEvent(ROBOCORE_LAUNCH, numOfPortInUse);
+
+	// Electronics beyond MAX_EVENT_SOURCE_NUM share source index 0, their 
+	// EVENTs reach no subscribed handler and isFrom() never matches them
+	unsigned char unindexedNum = RoboTerraEventSource::getUnindexedSourceNum();
+	if (unindexedNum != 0) {
+		sendPrintMessage("EVENT sources over limit: ", unindexedNum, (unindexedNum > 99) ? 3 : (unindexedNum > 9) ? 2 : 1);
+	}
+
+	// EVENTs generated in attach() are already queued, yet client code
+	// expects ROBOCORE_LAUNCH to be the first EVENT it handles
+	RoboTerraEvent launchEvent(this, ROBOCORE_LAUNCH, numOfPortInUse);
+	launchEvent.setTimestamp(loopMicros);
+	ROBOT.getEventQueue()->enqueueFront(launchEvent);
 }
 
 void RoboTerraRoboCore::terminate() {
@@ -98,10 +148,7 @@ void RoboTerraRoboCore::print(char *string) {
 		return;
 	}
 
-	Serial.write(0xF1); // Serial message begin marker
-	Serial.write(strlen(string)); // Length of the char array
-	Serial.print(string);
-	Serial.write(0xFF); // End marker
+	sendPrintMessage(string, 0, 0);
 }
 
 void RoboTerraRoboCore::print(int num) {
@@ -129,10 +176,7 @@ void RoboTerraRoboCore::print(int num) {
 		digit++;
 	}
 
-	Serial.write(0xF1); // Serial message begin marker
-	Serial.write(digit); // Length of the integer 
-	Serial.print(num);
-	Serial.write(0xFF); // End marker
+	sendPrintMessage("", num, digit);
 }
 
 void RoboTerraRoboCore::print(char *string, int num) {
@@ -163,95 +207,678 @@ void RoboTerraRoboCore::print(char *string, int num) {
 		digit++;
 	}
 
-	Serial.write(0xF1); // Serial message begin marker
-	Serial.write(digit + strlen(string));
-	Serial.print(string);
-	Serial.print(num);
-	Serial.write(0xFF); // End marker
+	sendPrintMessage(string, num, digit);
 }
 
 void RoboTerraRoboCore::time(RoboTerraTimeUnit length) {
 	if (state == STATE_COMMENCE || state == STATE_TERMINATE) {
 		return;
 	}
-	if (!isTimerActive) {
-		timerLength = (unsigned long)length;
-		if (timerLength > TWO_MIN) {
-			return;
+	if (!timerWheel.isActive(0)) {
+		timerWheel.start(0, loopMillis, (unsigned long)length, false);
+	}
+}
+
+void RoboTerraRoboCore::startTimer(int timerID, unsigned long length) {
+	if (state == STATE_COMMENCE || state == STATE_TERMINATE) {
+		return;
+	}
+	if (timerID >= 0) {
+		timerWheel.start(timerID, loopMillis, length, false); // Restart if running
+	}
+}
+
+void RoboTerraRoboCore::startPeriodicTimer(int timerID, unsigned long period) {
+	if (state == STATE_COMMENCE || state == STATE_TERMINATE) {
+		return;
+	}
+	if (timerID >= 0) {
+		timerWheel.start(timerID, loopMillis, period, true);
+	}
+}
+
+void RoboTerraRoboCore::stopTimer(int timerID) {
+	if (timerID >= 0) {
+		timerWheel.stop(timerID);
+	}
+}
+
+bool RoboTerraRoboCore::isTimerActive(int timerID) {
+	return timerID >= 0 && timerWheel.isActive(timerID);
+}
+
+unsigned int RoboTerraRoboCore::getMissedTimerPeriods(int timerID) {
+	return (timerID < 0) ? 0 : timerWheel.getMissedPeriods(timerID);
+}
+
+bool RoboTerraRoboCore::addControlLoop(RoboTerraControlCallback callback, unsigned long periodMicros) {
+	if (callback == NULL || periodMicros < MIN_CONTROL_PERIOD) {
+		return false;
+	}
+	int index = findControlLoop(callback);
+	if (index < 0) {
+		index = findControlLoop(NULL); // Removed by a callback, not yet compacted
+	}
+	if (index < 0) {
+		if (controlLoopNum >= CONTROL_LOOP_NUM) {
+			return false;
 		}
-		nowMillis = millis();
-		isTimerActive = true;
+		index = controlLoopNum;
+		controlLoopNum++;
 	}
+	ControlLoop *loop = &controlLoops[index]; // Restart if added before
+	loop->callback = callback;
+	loop->period = periodMicros;
+	loop->nextMicros = micros() + periodMicros;
+	loop->maxLateMicros = 0;
+	loop->missedNum = 0;
+	return true;
 }
 
-void RoboTerraRoboCore::runPeripheralStateMachines() {
+void RoboTerraRoboCore::removeControlLoop(RoboTerraControlCallback callback) {
+	int index = findControlLoop(callback);
+	if (callback == NULL || index < 0) {
+		return;
+	}
+	controlLoops[index].callback = NULL;
+	if (!isRunningControlLoops) {
+		compactControlLoops(); // A callback removing one only marks it, entries must not move under the run
+	}
+}
+
+unsigned int RoboTerraRoboCore::getMissedDeadlines(RoboTerraControlCallback callback) {
+	int index = findControlLoop(callback);
+	return (index < 0) ? 0 : controlLoops[index].missedNum;
+}
+
+unsigned long RoboTerraRoboCore::getMaxControlLateness(RoboTerraControlCallback callback) {
+	int index = findControlLoop(callback);
+	return (index < 0) ? 0 : controlLoops[index].maxLateMicros;
+}
+
+void RoboTerraRoboCore::setEventPriority(RoboTerraEventType type, RoboTerraEventPriority priority) {
+	ROBOT.getEventQueue()->setPriority(type, priority);
+}
+
+int RoboTerraRoboCore::getMaxEventBacklog(RoboTerraEventPriority priority) {
+	return ROBOT.getEventQueue()->getMaxBacklog(priority);
+}
+
+void RoboTerraRoboCore::setEventCoalescing(RoboTerraEventType type, bool isCoalesced) {
+	ROBOT.getEventQueue()->setCoalescing(type, isCoalesced);
+}
+
+void RoboTerraRoboCore::setEventOverflowPolicy(RoboTerraEventPriority priority, RoboTerraOverflowPolicy policy) {
+	ROBOT.getEventQueue()->setOverflowPolicy(priority, policy);
+}
+
+unsigned int RoboTerraRoboCore::getEventDropCount(RoboTerraEventPriority priority) {
+	return ROBOT.getEventQueue()->getDropCount(priority);
+}
+
+void RoboTerraRoboCore::reportEventQueues(RoboTerraTimeUnit interval) {
+	reportInterval = (unsigned long)interval;
+	lastReportMillis = loopMillis;
+}
+
+unsigned int RoboTerraRoboCore::getMessageDropCount() {
+	return ROBOT.getTxBuffer()->getDropCount();
+}
+
+int RoboTerraRoboCore::getUnindexedSourceNum() {
+	return RoboTerraEventSource::getUnindexedSourceNum();
+}
+
+void RoboTerraRoboCore::setWireFormat(RoboTerraWireFormat format) {
+	RoboTerraEventSource::setWireFormat(format); // Announced to app at once and again at launch()
+}
+
+unsigned int RoboTerraRoboCore::getCommandErrorCount() {
+	return commandParser.getErrorCount();
+}
+
+unsigned long RoboTerraRoboCore::getIdleMicros() {
+	return idleMicros;
+}
+
+unsigned long RoboTerraRoboCore::getBusyMicros() {
+	return (micros() - idleStatsMicros) - idleMicros;
+}
+
+void RoboTerraRoboCore::clearIdleStats() {
+	idleMicros = 0;
+	idleStatsMicros = micros();
+}
+
+#ifdef ROBOCORE_PROFILE_LOOP
+void RoboTerraRoboCore::profileLoop(RoboTerraTimeUnit interval) {
+	loopProfiler.start((unsigned long)interval);
+}
+#endif
+
+#ifdef ROBOCORE_WATCH_LOOP
+void RoboTerraRoboCore::watchLoop(unsigned long budgetMicros) {
+	RoboTerraLoopMonitor::start(budgetMicros, 0);
+}
+
+void RoboTerraRoboCore::watchLoop(unsigned long budgetMicros, unsigned int resetMillis) {
+	RoboTerraLoopMonitor::start(budgetMicros, resetMillis);
+}
+#endif
+
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+unsigned int RoboTerraRoboCore::getCycleCalls(RoboTerraEventSource &source, RoboTerraCycleKind kind) {
+	return source.getCycleCalls(kind);
+}
+
+unsigned long RoboTerraRoboCore::getCycleMicros(RoboTerraEventSource &source, RoboTerraCycleKind kind) {
+	return source.getCycleMicros(kind);
+}
+
+unsigned int RoboTerraRoboCore::getMaxCycleMicros(RoboTerraEventSource &source, RoboTerraCycleKind kind) {
+	return source.getMaxCycleMicros(kind);
+}
+
+void RoboTerraRoboCore::reportCycleStats() {
+	// One frame for RoboCore and one per attached electronics, sent over
+	// the following passes as serial buffer frees up
+	cycleReportSlot = -1;
+	continueCycleReport();
+}
+
+void RoboTerraRoboCore::clearCycleStats() {
+	RoboTerraEventSource::clearCycleStats();
+	for (int i = 0; i < numOfPeripheral; i++) {
+		peripheralSlots[i]->clearCycleStats();
+	}
+}
+#endif
+
+void RoboTerraRoboCore::sampleLoopTime() {
+	// Each read of the clock disables interrupts, so read it once per pass
+	loopMicros = micros();
+	loopMillis = millis();
+#if defined(ROBOCORE_WATCH_LOOP) || defined(ROBOCORE_PROFILE_LOOP)
+	unsigned long busyEndMicros = isIdling ? idleSinceMicros : loopMicros; // Idle sleep is not busy
+#endif
+
+	// Time from idle() to this pass counts as idle, woken or not
+	if (isIdling) {
+		idleMicros += loopMicros - idleSinceMicros;
+		isIdling = false;
+	}
+
+#ifdef ROBOCORE_PROFILE_LOOP
+	if (state == STATE_OPERATE) {
+		loopProfiler.markPass(busyEndMicros, loopMicros);
+	}
+#endif
+#ifdef ROBOCORE_WATCH_LOOP
+	if (RoboTerraLoopMonitor::endPass(busyEndMicros, loopMicros) && state == STATE_OPERATE) {
+		generateEvent(ROBOCORE_LOOP_OVERRUN, RoboTerraLoopMonitor::getCulpritSource(), RoboTerraLoopMonitor::getCulpritStage());
+	}
+#endif
+}
+
+unsigned long RoboTerraRoboCore::getLoopMillis() {
+	return loopMillis;
+}
+
+unsigned long RoboTerraRoboCore::getLoopMicros() {
+	return loopMicros;
+}
+
+void RoboTerraRoboCore::runControlLoops() {
+	if (state == STATE_OPERATE) {
+		isRunningControlLoops = true;
+		for (int i = 0; i < controlLoopNum; i++) {
+			ControlLoop *loop = &controlLoops[i];
+			if (loop->callback == NULL) {
+				continue; // Removed during this run
+			}
+			long lateMicros = (long)(loopMicros - loop->nextMicros);
+			if (lateMicros < 0) {
+				continue;
+			}
+			if ((unsigned long)lateMicros > loop->maxLateMicros) {
+				loop->maxLateMicros = lateMicros;
+			}
+
+			// Next deadline is on the grid of the first one, not now + period,
+			// so lateness of one run does not shift the rest
+			loop->nextMicros += loop->period;
+			while ((long)(loopMicros - loop->nextMicros) >= 0) {
+				loop->nextMicros += loop->period; // Skip, never run a burst to catch up
+				if (loop->missedNum != 0xFFFF) {
+					loop->missedNum++;
+				}
+			}
+
+			LOOP_STEP(STAGE_CONTROL_LOOP, i);
+			loop->callback();
+		}
+		isRunningControlLoops = false;
+		compactControlLoops();
+		LOOP_STEP(STAGE_KERNAL, 0);
+	}
+}
+
+void RoboTerraRoboCore::handleInterruptEvents() {
 	if (state == STATE_OPERATE) {
-		for (int i = 0; i < numOfPortInUse; i++) {
-			RoboTerraElectronics* peripheral = portsInUse[i].ptToElectronicsOnPort;
-			if (peripheral->readStateMachineFlag()) {
-				peripheral->runStateMachine();
+		// Interrupts stay enabled, ISRs keep publishing while draining
+		RoboTerraEvent event;
+		while (ISR_EVENT_QUEUE.dequeue(event)) {
+			RoboTerraEventSource *source = event.getSource();
+			if (source != NULL) {
+				LOOP_STEP(STAGE_INTERRUPT_EVENT, source->getSourceIndex());
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+				unsigned long startMicros = micros();
+#endif
+				RoboTerraEventSource::beginInterruptStamp(event);
+				source->handleInterruptEvent(event);
+				RoboTerraEventSource::endInterruptStamp();
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+				source->recordCycle(CYCLE_INTERRUPT_EVENT, startMicros);
+#endif
 			}
 		}
+		LOOP_STEP(STAGE_KERNAL, 0);
 	}
 }
 
-void RoboTerraRoboCore::handlePeripheralEvents() {
+void RoboTerraRoboCore::handleCommands() {
 	if (state == STATE_OPERATE) {
-		for (int i = 0; i < numOfPortInUse; i++) {
-			RoboTerraElectronics* peripheral = portsInUse[i].ptToElectronicsOnPort;
-			while (peripheral->getEventQueue()->isEmpty() == false) {
-				RoboTerraEvent event = peripheral->getEventQueue()->dequeue();
-				ROBOT.getEventQueue()->enqueue(event);
+		// Electronics act on a command in the same pass it is read
+		const RoboTerraCommand *command;
+		while ((command = commandParser.parse(loopMillis)) != NULL) {
+			if (!dispatchCommand(*command)) {
+				commandParser.countError();
 			}
 		}
+		LOOP_STEP(STAGE_KERNAL, 0);
 	}
 }
 
-void RoboTerraRoboCore::handleRoboCoreEvents() {
+void RoboTerraRoboCore::runPeripheralStateMachines() {
 	if (state == STATE_OPERATE) {
-		while (sourceEventQueue->isEmpty() == false) {
-				RoboTerraEvent event = sourceEventQueue->dequeue();
-				ROBOT.getEventQueue()->enqueue(event);
+		// Wake peripherals whose deadline passed, earliest on top
+		while (sleepNum > 0 && (long)(loopMillis - sleepHeap[0]->wakeMillis) >= 0) {
+			unschedulePeripheral(sleepHeap[0]);
+		}
+
+		if (registrySlotMask != 0) {
+			ROBOT.getPeripheralRegistry()->runStateMachines(loopMillis);
+		}
+
+		// Visit set bits only, an idle pass costs one test of the mask
+		unsigned long pendingMask = serviceMask & ~registrySlotMask;
+		unsigned char slot = 0;
+		while (pendingMask != 0) {
+			if ((pendingMask & 0xFF) == 0) {
+				pendingMask >>= 8; // Skip 8 idle slots at once
+				slot += 8;
+				continue;
+			}
+			if (pendingMask & 0x01) {
+				LOOP_STEP(STAGE_STATE_MACHINE, peripheralSlots[slot]->getSourceIndex());
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+				unsigned long startMicros = micros();
+#endif
+				peripheralSlots[slot]->runStateMachine(loopMillis);
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+				peripheralSlots[slot]->recordCycle(CYCLE_STATE_MACHINE, startMicros);
+#endif
+			}
+			pendingMask >>= 1;
+			slot++;
 		}
+		LOOP_STEP(STAGE_KERNAL, 0);
 	}
 }
 
 void RoboTerraRoboCore::checkRoboCoreTimer() {
 	if (state == STATE_OPERATE) {
-		if (isTimerActive) {
-			if ((millis() - nowMillis) > timerLength) {
-				if (timerLength > 999) {
-					timerLength = timerLength / 1000; // Convert to seconds
- 				}
-				sendEventMessage(STATE_OPERATE, ROBOCORE_TIME_UP, timerLength);
-				generateEvent(ROBOCORE_TIME_UP, timerLength);
-				isTimerActive = false;
-			} 
+		unsigned char timerID;
+		while (timerWheel.poll(loopMillis, timerID)) {
+			unsigned long timerLength = timerWheel.getLength(timerID);
+			if (timerLength > 999) {
+				timerLength = timerLength / 1000; // Convert to seconds
+			}
+			sendEventMessage(STATE_OPERATE, ROBOCORE_TIME_UP, timerLength, timerID);
+			generateEvent(ROBOCORE_TIME_UP, timerLength, timerID);
 		}
 	}
 }
 
+void RoboTerraRoboCore::checkQueueReport() {
+	if (state == STATE_OPERATE && reportInterval > 0) {
+		if ((loopMillis - lastReportMillis) >= reportInterval) {
+			lastReportMillis += reportInterval;
+			sendQueueReport();
+		}
+	}
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+	continueCycleReport();
+#endif
+}
+
+void RoboTerraRoboCore::flushEventMessages() {
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+	unsigned long startMicros = micros();
+#endif
+	RoboTerraEventSource::flushEventMessages();
+	ROBOT.getTxBuffer()->pump();
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+	recordCycle(CYCLE_SEND_MESSAGE, startMicros);
+#endif
+}
+
+void RoboTerraRoboCore::idle() {
+	if (state != STATE_OPERATE) {
+		return;
+	}
+#if defined(__AVR__)
+	set_sleep_mode(SLEEP_MODE_IDLE); // Timers, UART and pin interrupts keep running
+	cli(); // An ISR between the check and sleep_cpu() would not wake us
+	if (isWorkPending()) {
+		sei();
+		return;
+	}
+	idleSinceMicros = micros();
+	isIdling = true;
+	sleep_enable();
+	sei(); // Takes effect after next instruction, so no ISR sneaks in
+	sleep_cpu(); // Woken by any interrupt, at the latest the millis() tick
+	sleep_disable();
+#else
+	// No sleep instruction off target, account the time until next pass
+	if (!isWorkPending()) {
+		idleSinceMicros = micros();
+		isIdling = true;
+	}
+#endif
+}
+
+void RoboTerraRoboCore::schedulePeripheral(RoboTerraElectronics *peripheral, unsigned long deadline) {
+	peripheral->wakeMillis = deadline;
+	if (peripheral->sleepIndex < 0) {
+		if (sleepNum >= PORT_NUM) {
+			return; // Stays awake and polled
+		}
+		placeInSleepHeap(peripheral, sleepNum);
+		sleepNum++;
+		updateServiceMask(peripheral);
+	}
+	// Deadline of a sleeping one may move either way
+	siftUp(peripheral->sleepIndex);
+	siftDown(peripheral->sleepIndex);
+}
+
+void RoboTerraRoboCore::unschedulePeripheral(RoboTerraElectronics *peripheral) {
+	int heapIndex = peripheral->sleepIndex;
+	if (heapIndex < 0) {
+		return;
+	}
+	peripheral->sleepIndex = -1;
+	updateServiceMask(peripheral);
+	sleepNum--;
+	if (heapIndex < sleepNum) {
+		// Fill the hole with the last one and restore heap order
+		placeInSleepHeap(sleepHeap[sleepNum], heapIndex);
+		siftUp(heapIndex);
+		siftDown(sleepHeap[heapIndex]->sleepIndex);
+	}
+}
+
+void RoboTerraRoboCore::updateServiceMask(RoboTerraElectronics *peripheral) {
+	if (peripheral->serviceSlot < 0) {
+		return;
+	}
+	unsigned long slotBit = 1UL << peripheral->serviceSlot;
+	if (peripheral->stateMachineFlag && peripheral->sleepIndex < 0) {
+		serviceMask |= slotBit;
+	}
+	else {
+		serviceMask &= ~slotBit;
+	}
+}
+
 /************************** Private Class Functions *************************/
 
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+void RoboTerraRoboCore::continueCycleReport() {
+	while (cycleReportSlot < numOfPeripheral) {
+		if (!ROBOT.getTxBuffer()->hasRoom(3 + CYCLE_REPORT_LENGTH, TX_PRIORITY_LOW)) {
+			return; // Next pass
+		}
+		if (cycleReportSlot < 0) {
+			sendCycleReport(*this, (RoboCorePortID)0);
+		}
+		else {
+			for (int j = 0; j < numOfPortInUse; j++) {
+				if (portsInUse[j].ptToElectronicsOnPort == peripheralSlots[cycleReportSlot]) {
+					sendCycleReport(*peripheralSlots[cycleReportSlot], portsInUse[j].portID); // First port
+					break;
+				}
+			}
+		}
+		cycleReportSlot++;
+	}
+}
+
+void RoboTerraRoboCore::sendCycleReport(RoboTerraEventSource &source, RoboCorePortID portID) {
+	uint8_t reportMessageLength = 3 + CYCLE_REPORT_LENGTH;
+	uint8_t reportMessage[reportMessageLength]; // Cycle Report Message
+
+	reportMessage[0] = 0xF4;                         // Cycle Report Begin
+	reportMessage[1] = (uint8_t)CYCLE_REPORT_LENGTH; // Message Length
+	reportMessage[2] = source.getSourceIndex();
+	reportMessage[3] = (uint8_t)portID;              // 0 for RoboCore
+	for (int i = 0; i < CYCLE_KIND_NUM; i++) {
+		RoboTerraCycleKind kind = (RoboTerraCycleKind)i;
+		unsigned int calls = source.getCycleCalls(kind);
+		unsigned int maxMicros = source.getMaxCycleMicros(kind);
+		unsigned long totalMicros = source.getCycleMicros(kind);
+		uint8_t *field = &reportMessage[4 + 8 * i];
+		field[0] = (uint8_t)calls;
+		field[1] = (uint8_t)(calls >> 8);
+		field[2] = (uint8_t)maxMicros;
+		field[3] = (uint8_t)(maxMicros >> 8);
+		for (int j = 0; j < 4; j++) {
+			field[4 + j] = (uint8_t)(totalMicros >> (8 * j));
+		}
+	}
+	reportMessage[reportMessageLength - 1] = 0xFF;   // End marker
+
+	ROBOT.getTxBuffer()->write(reportMessage, reportMessageLength, TX_PRIORITY_LOW);
+}
+#endif
+
+void RoboTerraRoboCore::assignServiceSlot(RoboTerraElectronics &electronics) {
+	if (electronics.serviceSlot >= 0 || numOfPeripheral >= PORT_NUM) {
+		return; // Attached already or out of slot
+	}
+	electronics.serviceSlot = numOfPeripheral;
+	peripheralSlots[numOfPeripheral] = &electronics;
+	numOfPeripheral++;
+	updateServiceMask(&electronics);
+}
+
+bool RoboTerraRoboCore::isEarlier(int heapIndex, int otherIndex) {
+	// Signed difference stays correct across millis() overflow
+	return (long)(sleepHeap[heapIndex]->wakeMillis - sleepHeap[otherIndex]->wakeMillis) < 0;
+}
+
+void RoboTerraRoboCore::placeInSleepHeap(RoboTerraElectronics *peripheral, int heapIndex) {
+	sleepHeap[heapIndex] = peripheral;
+	peripheral->sleepIndex = heapIndex;
+}
+
+void RoboTerraRoboCore::siftUp(int heapIndex) {
+	while (heapIndex > 0) {
+		int parent = (heapIndex - 1) / 2;
+		if (!isEarlier(heapIndex, parent)) {
+			return;
+		}
+		RoboTerraElectronics *peripheral = sleepHeap[heapIndex];
+		placeInSleepHeap(sleepHeap[parent], heapIndex);
+		placeInSleepHeap(peripheral, parent);
+		heapIndex = parent;
+	}
+}
+
+void RoboTerraRoboCore::siftDown(int heapIndex) {
+	for (;;) {
+		int earliest = heapIndex;
+		int child = 2 * heapIndex + 1;
+		if (child < sleepNum && isEarlier(child, earliest)) {
+			earliest = child;
+		}
+		if (child + 1 < sleepNum && isEarlier(child + 1, earliest)) {
+			earliest = child + 1;
+		}
+		if (earliest == heapIndex) {
+			return;
+		}
+		RoboTerraElectronics *peripheral = sleepHeap[heapIndex];
+		placeInSleepHeap(sleepHeap[earliest], heapIndex);
+		placeInSleepHeap(peripheral, earliest);
+		heapIndex = earliest;
+	}
+}
+
+int RoboTerraRoboCore::findControlLoop(RoboTerraControlCallback callback) {
+	for (int i = 0; i < controlLoopNum; i++) {
+		if (controlLoops[i].callback == callback) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+void RoboTerraRoboCore::compactControlLoops() {
+	// Keeps order, so a slot index stays the same pass to pass
+	int keptNum = 0;
+	for (int i = 0; i < controlLoopNum; i++) {
+		if (controlLoops[i].callback != NULL) {
+			controlLoops[keptNum++] = controlLoops[i];
+		}
+	}
+	controlLoopNum = keptNum;
+}
+
+bool RoboTerraRoboCore::dispatchCommand(const RoboTerraCommand &command) {
+	if (command.port == 0) {
+		// RoboCore itself, as in its EVENT messages. D0 is Serial RX, never attached then
+		LOOP_STEP(STAGE_COMMAND, getSourceIndex());
+		if (command.type == COMMAND_WIRE_FORMAT && command.dataNum >= 1
+			&& (command.data[0] == WIRE_FORMAT_STANDARD || command.data[0] == WIRE_FORMAT_COMPACT)) {
+			setWireFormat((RoboTerraWireFormat)command.data[0]);
+			return true;
+		}
+		return false;
+	}
+	for (int i = 0; i < numOfPortInUse; i++) {
+		if (portsInUse[i].portID == command.port) {
+			RoboTerraElectronics *electronics = portsInUse[i].ptToElectronicsOnPort;
+			LOOP_STEP(STAGE_COMMAND, electronics->getSourceIndex());
+			return electronics->handleCommand(command);
+		}
+	}
+	return false; // Nothing attached on port
+}
+
+bool RoboTerraRoboCore::isWorkPending() {
+	if (serviceMask != 0 || !ISR_EVENT_QUEUE.isEmpty() || Serial.available() > 0) {
+		return true; // Polled peripherals and received commands keep the CPU awake
+	}
+	if (!ROBOT.getEventQueue()->isEmpty()) {
+		return true; // EVENTs left over from a batch, or queued by a handler
+	}
+	unsigned long now = micros();
+	for (int i = 0; i < controlLoopNum; i++) {
+		// Sleep may last a whole millis() tick, so spin for the last one
+		if ((long)(controlLoops[i].nextMicros - now) < CONTROL_WAKE_MARGIN) {
+			return true;
+		}
+	}
+	unsigned long deadline;
+	return getNextDeadline(deadline) && (long)(millis() - deadline) >= 0;
+}
+
+bool RoboTerraRoboCore::getNextDeadline(unsigned long &deadline) {
+	bool isFound = timerWheel.getNextExpiry(deadline);
+	if (sleepNum > 0 && (!isFound || (long)(sleepHeap[0]->wakeMillis - deadline) < 0)) {
+		deadline = sleepHeap[0]->wakeMillis;
+		isFound = true;
+	}
+	if (reportInterval > 0 && (!isFound || (long)(lastReportMillis + reportInterval - deadline) < 0)) {
+		deadline = lastReportMillis + reportInterval;
+		isFound = true;
+	}
+	return isFound;
+}
+
+void RoboTerraRoboCore::sendPrintMessage(const char *string, int num, unsigned char digit) {
+	uint8_t stringLength = strlen(string);
+	uint8_t printMessageLength = 3 + stringLength + digit;
+	uint8_t printMessage[printMessageLength]; // Print Message
+
+	printMessage[0] = 0xF1;                  // Serial message begin marker
+	printMessage[1] = stringLength + digit;  // Length of the chars
+	memcpy(&printMessage[2], string, stringLength);
+	long magnitude = (num < 0) ? -(long)num : num;
+	for (int i = 1 + stringLength + digit; i >= 2 + stringLength; i--) {
+		printMessage[i] = '0' + magnitude % 10; // No digit if digit is 0
+		magnitude /= 10;
+	}
+	if (num < 0) {
+		printMessage[2 + stringLength] = '-';
+	}
+	printMessage[printMessageLength - 1] = 0xFF; // End marker
+
+	RoboTerraEventSource::flushEventMessages(); // Keep order with EVENT messages
+	ROBOT.getTxBuffer()->write(printMessage, printMessageLength, TX_PRIORITY_HIGH);
+}
+
+void RoboTerraRoboCore::sendQueueReport() {
+	uint8_t reportMessageLength = 3 + QUEUE_REPORT_LENGTH;
+	uint8_t reportMessage[reportMessageLength]; // Queue Report Message
+	RoboTerraPriorityQueue *queue = ROBOT.getEventQueue();
+
+	reportMessage[0] = 0xF2;                        // Queue Report Begin
+	reportMessage[1] = (uint8_t)QUEUE_REPORT_LENGTH; // Message Length
+	for (int i = 0; i < PRIORITY_LEVEL_NUM; i++) {
+		RoboTerraEventPriority priority = (RoboTerraEventPriority)i;
+		unsigned int dropCount = queue->getDropCount(priority);
+		reportMessage[2 + i * 4] = (uint8_t)queue->getHighWaterMark(priority);
+		reportMessage[3 + i * 4] = (uint8_t)queue->getMaxBacklog(priority);
+		reportMessage[4 + i * 4] = (uint8_t)dropCount;
+		reportMessage[5 + i * 4] = (uint8_t)(dropCount >> 8);
+	}
+	reportMessage[14] = ISR_EVENT_QUEUE.getHighWaterMark();
+	reportMessage[15] = ISR_EVENT_QUEUE.getDropCount();
+	reportMessage[16] = 0xFF;                       // End marker
+
+	ROBOT.getTxBuffer()->write(reportMessage, reportMessageLength, TX_PRIORITY_LOW);
+}
+
 void RoboTerraRoboCore::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend) {
-	uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = 0;                      // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = 0xFF;                   // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+	encodeEventMessage<MessageFormat>(0, stateToSend, typeToSend, firstDataToSend);
+}
+
+void RoboTerraRoboCore::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend, int secondDataToSend) {
+	encodeEventMessage<TimerMessageFormat>(0, stateToSend, typeToSend, firstDataToSend, secondDataToSend);
 }
 
 void RoboTerraRoboCore::generateEvent(RoboTerraEventType type, int firstData) {
 	RoboTerraEvent newEvent(this, type, firstData);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
+
+
+void RoboTerraRoboCore::generateEvent(RoboTerraEventType type, int firstData, int secondData) {
+	RoboTerraEvent newEvent(this, type, firstData);
+	newEvent.setEventData(secondData, 1);
+    publishEvent(newEvent);
+}
\ No newline at end of file
@@ -14,10 +14,19 @@
 
 #include <RoboTerraBrain.h> // Parent class
 #include <RoboTerraElectronics.h>
+#include <RoboTerraTimerWheel.h>
+#include <RoboTerraLoopProfiler.h>
+#include <RoboTerraLoopMonitor.h>
+#include <RoboTerraCommandParser.h>
 
 /************************* Defined Constant ********************/
 
-#define PORT_NUM 22 // A total of 18 ports on RoboCore V1.4
+#define PORT_NUM 22 // A total of 18 ports on RoboCore V1.4, no more than 32 for service mask
+#define CONTROL_LOOP_NUM 4
+#define MIN_CONTROL_PERIOD 1000 // micros(), 1 kHz
+#define CONTROL_WAKE_MARGIN 1024 // micros() per Timer 0 overflow, the millis() tick
+
+typedef void (*RoboTerraControlCallback)();
 
 /************************* Actual Class Body ********************/
 
@@ -33,13 +42,65 @@ public:
     void print(char *string);
     void print(int num);
     void print(char *string, int num);
-    void time(RoboTerraTimeUnit length);
+    void time(RoboTerraTimeUnit length); // Same as timer ID 0, ignored while it runs
+    void startTimer(int timerID, unsigned long length);
+    void startPeriodicTimer(int timerID, unsigned long period);
+    void stopTimer(int timerID);
+    bool isTimerActive(int timerID);
+    unsigned int getMissedTimerPeriods(int timerID);
+    bool addControlLoop(RoboTerraControlCallback callback, unsigned long periodMicros);
+    void removeControlLoop(RoboTerraControlCallback callback);
+    unsigned int getMissedDeadlines(RoboTerraControlCallback callback);
+    unsigned long getMaxControlLateness(RoboTerraControlCallback callback);
+    void setEventPriority(RoboTerraEventType type, RoboTerraEventPriority priority);
+    int getMaxEventBacklog(RoboTerraEventPriority priority);
+    void setEventCoalescing(RoboTerraEventType type, bool isCoalesced);
+    void setEventOverflowPolicy(RoboTerraEventPriority priority, RoboTerraOverflowPolicy policy);
+    unsigned int getEventDropCount(RoboTerraEventPriority priority);
+    void reportEventQueues(RoboTerraTimeUnit interval);
+    unsigned int getMessageDropCount();
+    int getUnindexedSourceNum();
+    void setWireFormat(RoboTerraWireFormat format);
+    unsigned int getCommandErrorCount();
+    unsigned long getIdleMicros();
+    unsigned long getBusyMicros();
+    void clearIdleStats();
+#ifdef ROBOCORE_PROFILE_LOOP
+    void profileLoop(RoboTerraTimeUnit interval);
+#endif
+#ifdef ROBOCORE_WATCH_LOOP
+    void watchLoop(unsigned long budgetMicros);
+    void watchLoop(unsigned long budgetMicros, unsigned int resetMillis); // Hardware watchdog resets if stuck
+#endif
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    unsigned int getCycleCalls(RoboTerraEventSource &source, RoboTerraCycleKind kind);
+    unsigned long getCycleMicros(RoboTerraEventSource &source, RoboTerraCycleKind kind);
+    unsigned int getMaxCycleMicros(RoboTerraEventSource &source, RoboTerraCycleKind kind);
+    void reportCycleStats();
+    void clearCycleStats();
+#endif
 
     // Called by Kernal Loop
+    void sampleLoopTime(); // First thing in every pass
+    void runControlLoops();
+    void handleInterruptEvents();
+    void handleCommands(); // Every command the app has sent so far
     void runPeripheralStateMachines();
-    void handlePeripheralEvents();
-    void handleRoboCoreEvents();
     void checkRoboCoreTimer();
+    void checkQueueReport();
+    void flushEventMessages(); // One frame for all EVENT messages of the pass, then send what Serial takes
+    void idle(); // Sleep until next interrupt if no work is pending
+
+    // Called by RoboTerraElectronics::sleepUntil() and wake()
+    void schedulePeripheral(RoboTerraElectronics *peripheral, unsigned long deadline);
+    void unschedulePeripheral(RoboTerraElectronics *peripheral);
+
+    // Called by framework for time of current pass
+    unsigned long getLoopMillis();
+    unsigned long getLoopMicros();
+
+    // Called by RoboTerraElectronics::setStateMachineFlag()
+    void updateServiceMask(RoboTerraElectronics *peripheral);
 
 private:
     typedef struct {
@@ -51,12 +112,70 @@ private:
   	RoboCorePort portsInUse[PORT_NUM]; // Allocate memory for max number of ports
   	int numOfPortInUse;
 
-    unsigned long timerLength;
-    unsigned long nowMillis;
-    bool isTimerActive;
+    // Distinct peripherals, a Joystick takes two ports but one slot
+    RoboTerraElectronics* peripheralSlots[PORT_NUM];
+    int numOfPeripheral;
+    unsigned long serviceMask; // Bit set if slot is due for runStateMachine()
+    unsigned long registrySlotMask; // Slots run by RoboTerraPeripheralList instead
+
+    // Min-heap of sleeping peripherals ordered by wake up deadline
+    RoboTerraElectronics* sleepHeap[PORT_NUM];
+    int sleepNum;
 
+    unsigned long loopMillis; // Sampled once per pass of Kernal Loop
+    unsigned long loopMicros;
+
+    RoboTerraTimerWheel timerWheel; // ROBOCORE_TIME_UP carries timer ID as data 1
+
+    RoboTerraCommandParser commandParser;
+
+    typedef struct {
+        RoboTerraControlCallback callback;
+        unsigned long period;        // micros()
+        unsigned long nextMicros;    // Deadline, advanced by period to stay phase locked
+        unsigned long maxLateMicros; // Worst delay past deadline
+        unsigned int missedNum;      // Periods skipped because the loop was late
+    } ControlLoop;
+
+    ControlLoop controlLoops[CONTROL_LOOP_NUM];
+    int controlLoopNum;
+    bool isRunningControlLoops; // Removed entries keep their slot with NULL callback until the run ends
+
+    unsigned long idleMicros; // Time slept in idle() since idleStatsMicros
+    unsigned long idleStatsMicros;
+    unsigned long idleSinceMicros;
+    bool isIdling; // Set by idle(), cleared by next pass
+
+    unsigned long reportInterval; // 0 if queue report is off
+    unsigned long lastReportMillis;
+
+#ifdef ROBOCORE_PROFILE_LOOP
+    RoboTerraLoopProfiler loopProfiler;
+#endif
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    int cycleReportSlot; // Next one to send, -1 for RoboCore itself
+#endif
+
+    int findControlLoop(RoboTerraControlCallback callback);
+    void compactControlLoops();
+    bool dispatchCommand(const RoboTerraCommand &command);
+    bool isWorkPending();
+    bool getNextDeadline(unsigned long &deadline);
+    void sendPrintMessage(const char *string, int num, unsigned char digit);
+    void sendQueueReport();
+#ifdef ROBOCORE_PROFILE_PERIPHERALS
+    void continueCycleReport();
+    void sendCycleReport(RoboTerraEventSource &source, RoboCorePortID portID);
+#endif
+    void assignServiceSlot(RoboTerraElectronics &electronics);
+    bool isEarlier(int heapIndex, int otherIndex);
+    void placeInSleepHeap(RoboTerraElectronics *peripheral, int heapIndex);
+    void siftUp(int heapIndex);
+    void siftDown(int heapIndex);
     void sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend);
+    void sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend, int secondDataToSend);
     void generateEvent(RoboTerraEventType type, int firstData);
+    void generateEvent(RoboTerraEventType type, int firstData, int secondData);
 };
 
 #endif
\ No newline at end of file
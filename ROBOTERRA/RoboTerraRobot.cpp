@@ -21,12 +21,16 @@
 /************************** Class Member Functions *************************/ 
 
 RoboTerraRobot::RoboTerraRobot() {
-    // Allocate memomry for RoboTerraEventQueue
-    eventQueue = new RoboTerraEventQueue; 
+    // Memory for RoboTerraPriorityQueue is statically allocated
+    peripheralRegistry = NULL;
+    for (int i = 0; i < HANDLER_TABLE_SIZE; i++) {
+        handlerTable[i].sourceIndex = 0;
+        handlerTable[i].handler = NULL;
+    }
 }
 
 RoboTerraRobot::~RoboTerraRobot() {
-	eventQueue->clear();
+	eventQueue.clear();
 }
 
 void RoboTerraRobot::equip(RoboTerraRoboCore *controller) {
@@ -37,6 +41,79 @@ RoboTerraRoboCore* RoboTerraRobot::getRobotController() {
 	return robotController;
 }
 
-RoboTerraEventQueue* RoboTerraRobot::getEventQueue() {
-	return eventQueue;
+RoboTerraPriorityQueue* RoboTerraRobot::getEventQueue() {
+	return &eventQueue;
+}
+
+RoboTerraTxBuffer* RoboTerraRobot::getTxBuffer() {
+	return &txBuffer;
+}
+
+void RoboTerraRobot::setPeripheralRegistry(RoboTerraPeripheralRegistry *registry) {
+	peripheralRegistry = registry;
+}
+
+RoboTerraPeripheralRegistry* RoboTerraRobot::getPeripheralRegistry() {
+	return peripheralRegistry;
+}
+
+/*****************************************************************
+ Description
+ Subscribe a handler to EVENTs of a type from a source, replacing 
+ any handler already subscribed to the same pair
+
+ Return 
+ false if the table is full
+*****************************************************************/
+
+bool RoboTerraRobot::subscribe(RoboTerraEventSource &source, RoboTerraEventType type, RoboTerraEventHandler handler) {
+    if (source.getSourceIndex() == 0) {
+        return false; // Source out of index
+    }
+    int index = findHandlerEntry(source.getSourceIndex(), (unsigned char)type);
+    if (index < 0) {
+        return false;
+    }
+    handlerTable[index].sourceIndex = source.getSourceIndex();
+    handlerTable[index].type = (unsigned char)type;
+    handlerTable[index].handler = handler;
+    return true;
+}
+
+void RoboTerraRobot::unsubscribe(RoboTerraEventSource &source, RoboTerraEventType type) {
+    int index = findHandlerEntry(source.getSourceIndex(), (unsigned char)type);
+    if (index >= 0 && handlerTable[index].sourceIndex != 0) {
+        handlerTable[index].handler = NULL; // Entry kept so probing goes on
+    }
+}
+
+void RoboTerraRobot::dispatch(RoboTerraEvent &event) {
+    int index = findHandlerEntry(event.getSourceIndex(), (unsigned char)event.type());
+    if (event.getSourceIndex() != 0 && index >= 0 && handlerTable[index].handler != NULL) {
+        handlerTable[index].handler(event);
+    }
+}
+
+/************************** Private Class Functions *************************/
+
+int RoboTerraRobot::findHandlerEntry(unsigned char sourceIndex, unsigned char type) {
+    // Return the entry of the pair, or the entry where it belongs: the first
+    // unsubscribed one on the probe, otherwise the unused one ending it.
+    // The table is sparsely filled so a probe normally ends at first entry.
+    unsigned char index = (unsigned char)(sourceIndex * 3 + type * 5);
+    int unsubscribedIndex = -1;
+    for (int i = 0; i < HANDLER_TABLE_SIZE; i++) {
+        int entryIndex = (index + i) & (HANDLER_TABLE_SIZE - 1);
+        HandlerEntry *entry = &handlerTable[entryIndex];
+        if (entry->sourceIndex == sourceIndex && entry->type == type) {
+            return entryIndex;
+        }
+        if (entry->sourceIndex == 0) {
+            return (unsubscribedIndex >= 0) ? unsubscribedIndex : entryIndex;
+        }
+        if (entry->handler == NULL && unsubscribedIndex < 0) {
+            unsubscribedIndex = entryIndex; // Reused, probing goes on past it
+        }
+    }
+    return unsubscribedIndex; // -1 if full and not found
 }
\ No newline at end of file
@@ -13,7 +13,18 @@
 /************************* Incldued Dependencies ********************/ 
 
 #include <RoboTerraRoboCore.h>
-#include <RoboTerraEventQueue.h>
+#include <RoboTerraPriorityQueue.h>
+#include <RoboTerraTxBuffer.h>
+
+/************************* Defined Constant ********************/
+
+#define HANDLER_TABLE_SIZE 16 // Max subscriptions, must be a power of two
+
+typedef void (*RoboTerraEventHandler)(RoboTerraEvent &event);
+
+/************************* Forward Declared Dependencies ********************/
+
+class RoboTerraPeripheralRegistry;
 
 /************************* Actual Class Body ********************/
 
@@ -24,11 +35,34 @@ public:
     ~RoboTerraRobot();
     void equip(RoboTerraRoboCore *controller);
     RoboTerraRoboCore* getRobotController();
-    RoboTerraEventQueue* getEventQueue();
+    RoboTerraPriorityQueue* getEventQueue();
+    RoboTerraTxBuffer* getTxBuffer();
+    void setPeripheralRegistry(RoboTerraPeripheralRegistry *registry);
+    RoboTerraPeripheralRegistry* getPeripheralRegistry();
+
+    // API Functions released to clients
+    bool subscribe(RoboTerraEventSource &source, RoboTerraEventType type, RoboTerraEventHandler handler);
+    void unsubscribe(RoboTerraEventSource &source, RoboTerraEventType type);
+
+    // Called by Kernal Loop
+    void dispatch(RoboTerraEvent &event);
 
 private:
     RoboTerraRoboCore *robotController;
-    RoboTerraEventQueue *eventQueue; 
+    RoboTerraPriorityQueue eventQueue; // No heap allocation
+    RoboTerraTxBuffer txBuffer; // All frames to the app go through it
+    RoboTerraPeripheralRegistry *peripheralRegistry; // NULL if sketch has none
+
+    // Open addressing hash table keyed by EVENT source and type
+    typedef struct {
+        unsigned char sourceIndex; // 0 if never used
+        unsigned char type;
+        RoboTerraEventHandler handler; // NULL if unsubscribed
+    } HandlerEntry;
+
+    HandlerEntry handlerTable[HANDLER_TABLE_SIZE];
+
+    int findHandlerEntry(unsigned char sourceIndex, unsigned char type);
 };
 
 #endif
\ No newline at end of file
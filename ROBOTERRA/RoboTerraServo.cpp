@@ -37,7 +37,9 @@
 #define STATE_MOVE           2  
 
 #define DEVICE_ID            120   
-#define MSG_LENGTH           6
+#define DATA_NUM             2
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /************************ Module Variable ***********************/
 
@@ -47,6 +49,10 @@ unsigned int widthArray[181]; // Store mapping data between angle(0-181) to widt
 unsigned char servoCount = 0; // Total number of attached servos (must be in .cpp file)
 unsigned char activeServoNum = 0; // No. of active servos
 
+/************************ Forward Declaration ********************/
+
+extern RoboTerraInterruptQueue ISR_EVENT_QUEUE; // Global variable
+
 /************************ Public Functions **********************/
 
 /*****************************************************************
@@ -235,13 +241,10 @@ void RoboTerraServo::resume() {
 
 void RoboTerraServo::attach(int portID) {
     if (servoIndex < MAX_SERVO_NUMBER) {
-        // Allocate memomry for RoboTerraEventQueue
-        sourceEventQueue = new RoboTerraEventQueue; 
-
         pinMode(portID, OUTPUT);
         servos[servoIndex].pinNumber = portID;
         servos[servoIndex].state = STATE_STOP;
-        servos[servoIndex].stateMachineFlag = false;
+        servos[servoIndex].source = this;
 
         sendEventMessage(STATE_INACTIVE, DEACTIVATE, (int)activeServoNum, 0);
         generateEvent(DEACTIVATE, (int)activeServoNum, 0);
@@ -249,18 +252,25 @@ void RoboTerraServo::attach(int portID) {
     // More than 4 servo if reach here
 }
 
-bool RoboTerraServo::readStateMachineFlag() {
-    return servos[servoIndex].stateMachineFlag;
+bool RoboTerraServo::handleCommand(const RoboTerraCommand &command) {
+    if (command.type != COMMAND_SERVO_ROTATE || command.dataNum < 2) {
+        return false;
+    }
+    rotate(command.data[0], command.data[1]);
+    return true;
+}
+
+void RoboTerraServo::runStateMachine(unsigned long nowMillis) {
+    // Left blank intentionally b/c servo is interrupt driven.
+    // EVENTs published by ISR are handled in handleInterruptEvent()
 }
 
-void RoboTerraServo::runStateMachine() {
-    // Kernal does NOT call it to run State Machine b/c servo is interrupt driven.
-    // However, this function is called to send EVENT messeage, genereted in ISR
-    if (servos[servoIndex].stateMachineFlag) {
-        generateEvent(servos[channel].typeToSend, pulseWidthToAngle(ticksToUs(servos[servoIndex].currentTicks)), 0);
-        sendEventMessage(STATE_STOP, servos[channel].typeToSend, pulseWidthToAngle(ticksToUs(servos[servoIndex].currentTicks)), 0);
-    }    
-    servos[servoIndex].stateMachineFlag = false; // Only genrate and send ONE EVENT
+void RoboTerraServo::handleInterruptEvent(RoboTerraEvent &event) {
+    // ISR only records ticks when a rotation ends. Mapping ticks to
+    // angle is too slow for ISR thus done here by the kernal.
+    int angle = pulseWidthToAngle(ticksToUs((unsigned int)event.getData()));
+    generateEvent(event.type(), angle, 0);
+    sendEventMessage(STATE_STOP, event.type(), angle, 0);
 }
 
 /************************** Private Class Functions *************************/
@@ -295,29 +305,13 @@ void RoboTerraServo::startISR() {
 }
 
 void RoboTerraServo::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend, int secondDataToSend) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = (uint8_t)servos[servoIndex].pinNumber; // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = (uint8_t)secondDataToSend;
-    eventMessage[10] = (uint8_t)(secondDataToSend >> 8);
-    eventMessage[11] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(servos[servoIndex].pinNumber, stateToSend, typeToSend, firstDataToSend, secondDataToSend);
 }
 
 void RoboTerraServo::generateEvent(RoboTerraEventType type, int firstData, int secondData) {
     RoboTerraEvent newEvent(this, type, firstData);
     newEvent.setEventData(secondData, 1);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
 
 /*****************************************************************
@@ -345,14 +339,12 @@ ISR(TIMER1_COMPA_vect) {
             if (servos[channel].state == STATE_STOP) {
                 servos[channel].speed = 0; // Make sure below section entered ONLY once
                 if (servos[channel].currentTicks < servos[channel].targetTicks) { 
-                    servos[channel].stateMachineFlag = true; // To send EVENT message
-                    
-                    servos[channel].typeToSend = SERVO_INCREASE_END;
+                    // Publish EVENT to kernal
+                    ISR_EVENT_QUEUE.enqueue(RoboTerraEvent(servos[channel].source, SERVO_INCREASE_END, servos[channel].currentTicks));
                 }
                 else if (servos[channel].currentTicks > servos[channel].targetTicks) {
-                    servos[channel].stateMachineFlag = true; // To send EVENT message
-                    
-                    servos[channel].typeToSend = SERVO_DECREASE_END;
+                    // Publish EVENT to kernal
+                    ISR_EVENT_QUEUE.enqueue(RoboTerraEvent(servos[channel].source, SERVO_DECREASE_END, servos[channel].currentTicks));
                 }
                 else { // currentTicks == targetTicks
                        // Intentionally left blank
@@ -369,9 +361,8 @@ ISR(TIMER1_COMPA_vect) {
                         servos[channel].speed = 0;
 
                         servos[channel].state = STATE_STOP;
-                        servos[channel].stateMachineFlag = true; // To send EVENT message
-                        
-                        servos[channel].typeToSend = SERVO_INCREASE_END;
+                        // Publish EVENT to kernal
+                        ISR_EVENT_QUEUE.enqueue(RoboTerraEvent(servos[channel].source, SERVO_INCREASE_END, servos[channel].currentTicks));
                     }
                 }
                 // currentTicks == targetTicks thus decrement excluded from rotate(int, int)
@@ -383,9 +374,8 @@ ISR(TIMER1_COMPA_vect) {
                         servos[channel].speed = 0;
 
                         servos[channel].state = STATE_STOP;
-                        servos[channel].stateMachineFlag = true; // To send EVENT message
-                        
-                        servos[channel].typeToSend = SERVO_DECREASE_END;
+                        // Publish EVENT to kernal
+                        ISR_EVENT_QUEUE.enqueue(RoboTerraEvent(servos[channel].source, SERVO_DECREASE_END, servos[channel].currentTicks));
                     }
                 }
             }
@@ -30,14 +30,15 @@ typedef struct {
 	unsigned int initialTicks; // Used only when activated
 	bool isInitializing;
 	char state;
-    bool stateMachineFlag;
-    RoboTerraEventType typeToSend;
+	RoboTerraEventSource* source; // Instance that ISR publishes EVENTs for
 } servo_t;
 
 /************************* Actual Class Body ********************/
 
 class RoboTerraServo : public RoboTerraElectronics {
 
+    template <typename... T> friend class RoboTerraPeripheralList; // Calls runStateMachine()
+
 public:
 	// API Functions released to clients
 	RoboTerraServo();
@@ -52,8 +53,13 @@ protected:
     void attach(int portID);
 
     // Called by RoboTerraRoboCore::runPeripheralStateMachine()
-    bool readStateMachineFlag();
-    void runStateMachine();
+    void runStateMachine(unsigned long nowMillis);
+
+    // Called by RoboTerraRoboCore::handleInterruptEvents()
+    void handleInterruptEvent(RoboTerraEvent &event);
+
+    // Called by RoboTerraRoboCore::handleCommands()
+    bool handleCommand(const RoboTerraCommand &command);
 
 private:
 	unsigned char servoIndex;
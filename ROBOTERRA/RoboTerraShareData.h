@@ -24,6 +24,17 @@ Current Revision
 #ifndef RoboTerraShareData_h
 #define RoboTerraShareData_h
 
+/************************* Build Options ********************/
+
+// Uncomment to compile in Kernal Loop pass time histogram
+// #define ROBOCORE_PROFILE_LOOP
+
+// Uncomment to compile in time accounting of every EVENT source
+// #define ROBOCORE_PROFILE_PERIPHERALS
+
+// Uncomment to compile in Kernal Loop budget check and watchdog
+// #define ROBOCORE_WATCH_LOOP
+
 typedef enum { 
 
     // // RoboCore V1.1
@@ -117,6 +128,7 @@ typedef enum {
     ROBOCORE_LAUNCH         = 1,
     ROBOCORE_TERMINATE      = 2,
     ROBOCORE_TIME_UP        = 3,
+    ROBOCORE_LOOP_OVERRUN   = 4,
     
     // All RoboTerraElectronics 
     DEACTIVATE              = 10,
@@ -187,4 +199,68 @@ typedef enum {
     TWO_MIN     = 120000
 } RoboTerraTimeUnit;
 
+typedef enum {
+    PRIORITY_HIGH   = 0, // Dispatched first
+    PRIORITY_NORMAL = 1,
+    PRIORITY_LOW    = 2
+} RoboTerraEventPriority;
+
+typedef enum {
+    OVERFLOW_DROP_NEWEST = 0, // Discard EVENT being enqueued
+    OVERFLOW_DROP_OLDEST = 1, // Discard EVENT to be dequeued next
+    OVERFLOW_COALESCE    = 2  // Overwrite pending EVENT of same source and type, otherwise drop newest
+} RoboTerraOverflowPolicy;
+
+typedef enum {
+    TX_PRIORITY_HIGH = 0, // EVENT and print messages
+    TX_PRIORITY_LOW  = 1  // Reports, dropped first when serial falls behind
+} RoboTerraTxPriority;
+
+typedef enum {
+    WIRE_FORMAT_STANDARD = 0, // 0xF0 frames, what the app expects by default
+    WIRE_FORMAT_COMPACT  = 1  // 0xF7 and 0xF8 frames, varint data and one byte source index
+} RoboTerraWireFormat;
+
+typedef enum {
+    CYCLE_STATE_MACHINE   = 0, // runStateMachine(), including EVENTs it generates
+    CYCLE_INTERRUPT_EVENT = 1, // handleInterruptEvent(), e.g. IR decoding
+    CYCLE_SEND_MESSAGE    = 2, // Serial write of EVENT message
+    CYCLE_GENERATE_EVENT  = 3  // Publishing EVENT to queue
+} RoboTerraCycleKind;
+
+typedef enum {
+    STAGE_KERNAL          = 0, // Framework itself, source index 0
+    STAGE_STATE_MACHINE   = 1, // runStateMachine() of source
+    STAGE_INTERRUPT_EVENT = 2, // handleInterruptEvent() of source
+    STAGE_EVENT_HANDLER   = 3, // Client handlers of EVENT from source
+    STAGE_CONTROL_LOOP    = 4, // Callback of addControlLoop(), slot as source index
+    STAGE_COMMAND         = 5  // Command from app to source
+} RoboTerraLoopStage;
+
+typedef enum {
+    COMMAND_NULL         = 0,
+
+    // RoboTerraRoboCore command
+    COMMAND_WIRE_FORMAT  = 1,  // data 0 is RoboTerraWireFormat
+
+    // RoboTerraLED command
+    COMMAND_LED_TURN_ON  = 20,
+    COMMAND_LED_TURN_OFF = 21,
+    COMMAND_LED_BLINK    = 22, // data 0 is times, 0 to blink until stopped, data 1 is 1 for fast blink
+    COMMAND_LED_STOP     = 23,
+
+    // RoboTerraServo command
+    COMMAND_SERVO_ROTATE = 30, // data 0 is angle, data 1 is speed
+
+    // RoboTerraMotor command
+    COMMAND_MOTOR_ROTATE = 40  // data 0 is speed
+} RoboTerraCommandType;
+
+typedef struct {
+    unsigned char type;    // RoboTerraCommandType
+    unsigned char port;    // RoboCorePortID, 0 for RoboCore
+    unsigned char dataNum;
+    int data[2];           // Unused data is 0
+} RoboTerraCommand;
+
 #endif
\ No newline at end of file
@@ -36,7 +36,9 @@
 #define STATE_DEADBAND  3
 
 #define DEVICE_ID       14
-#define MSG_LENGTH      4
+#define DATA_NUM        1
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /***************************** Module Variable *****************************/
 
@@ -52,7 +54,7 @@ void RoboTerraSoundSensor::activate() {
     activeSoundSensorNum++;
 
     state = STATE_QUIET;
-    stateMachineFlag = true; // Let Kernal call runStateMachine()
+    setStateMachineFlag(true); // Let Kernal call runStateMachine()
 
     sendEventMessage(STATE_QUIET, ACTIVATE, (int)activeSoundSensorNum);
     generateEvent(ACTIVATE, (int)activeSoundSensorNum);
@@ -66,16 +68,13 @@ void RoboTerraSoundSensor::deactivate() {
     activeSoundSensorNum--;
 
     state = STATE_INACTIVE;
-    stateMachineFlag = false; // Let Kernal NOT call runStateMachine()
+    setStateMachineFlag(false); // Let Kernal NOT call runStateMachine()
 
     sendEventMessage(STATE_INACTIVE, DEACTIVATE, (int)activeSoundSensorNum);
     generateEvent(DEACTIVATE, (int)activeSoundSensorNum);
 }
   
 void RoboTerraSoundSensor::attach(int portID) {
-    // Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
     // Instance variables
     pin = (char)portID;
     pinMode(pin, INPUT);
@@ -86,10 +85,6 @@ void RoboTerraSoundSensor::attach(int portID) {
     activate();
 }
 
-bool RoboTerraSoundSensor::readStateMachineFlag() {
-    return stateMachineFlag;
-}
-
 /*********************************************************************
  Note 
  Sound Level starts to present when there exists sound or air vibration.
@@ -103,7 +98,7 @@ bool RoboTerraSoundSensor::readStateMachineFlag() {
   entered. Otherwise, timer expires and state goes back to STATE_QUIET
 
 *********************************************************************/
-void RoboTerraSoundSensor::runStateMachine() {
+void RoboTerraSoundSensor::runStateMachine(unsigned long nowMillis) {
     char currentLevel = digitalRead(pin);
     if(currentLevel != lastLevel) {
         lastLevel = currentLevel;
@@ -123,14 +118,14 @@ void RoboTerraSoundSensor::runStateMachine() {
         else { // LEVEL_SOUND to LEVEL_NORMAL
             if (state == STATE_NOISY) {
                 state = STATE_DEADBAND;
-                lastDebounceMillis = millis();
+                lastDebounceMillis = nowMillis;
                 // Let below codes run
             }
         }
     }
 
     if (state == STATE_DEADBAND) {
-        if((millis() - lastDebounceMillis) > DEADBANDTIME) { // Time up
+        if((nowMillis - lastDebounceMillis) > DEADBANDTIME) { // Time up
             state = STATE_QUIET;
             sendEventMessage(STATE_QUIET, SOUND_END, count);
             generateEvent(SOUND_END, count);
@@ -141,24 +136,10 @@ void RoboTerraSoundSensor::runStateMachine() {
 /************************** Private Class Functions *************************/
 
 void RoboTerraSoundSensor::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = (uint8_t)pin;           // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(pin, stateToSend, typeToSend, firstDataToSend);
 }
 
 void RoboTerraSoundSensor::generateEvent(RoboTerraEventType type, int firstData) {
     RoboTerraEvent newEvent(this, type, firstData);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
\ No newline at end of file
@@ -40,7 +40,9 @@
 #define STATE_DEBOUNCE  3 
 
 #define DEVICE_ID       11
-#define MSG_LENGTH      4
+#define DATA_NUM        1
+
+typedef RoboTerraMessageFormat<DEVICE_ID, DATA_NUM> MessageFormat;
 
 /***************************** Module Variable *****************************/
 
@@ -56,7 +58,7 @@ void RoboTerraTapeSensor::activate() {
     activeTapeSensorNum++;
 
     state = STATE_OFFTAPE;
-    stateMachineFlag = true; // Let Kernal call runStateMachine()
+    setStateMachineFlag(true); // Let Kernal call runStateMachine()
 
     sendEventMessage(STATE_OFFTAPE, ACTIVATE, (int)activeTapeSensorNum);
     generateEvent(ACTIVATE, (int)activeTapeSensorNum);
@@ -70,16 +72,13 @@ void RoboTerraTapeSensor::deactivate() {
     activeTapeSensorNum--;
 
     state = STATE_INACTIVE;
-    stateMachineFlag = false; // Let Kernal NOT call runStateMachine()
+    setStateMachineFlag(false); // Let Kernal NOT call runStateMachine()
 
     sendEventMessage(STATE_INACTIVE, DEACTIVATE, (int)activeTapeSensorNum);
     generateEvent(DEACTIVATE, (int)activeTapeSensorNum);
 }
 
 void RoboTerraTapeSensor::attach(int portID) {
-    // Allocate memomry for RoboTerraEventQueue
-    sourceEventQueue = new RoboTerraEventQueue; 
-
     // Instance variables
     pin = (char)portID;
     pinMode(pin, INPUT);
@@ -90,10 +89,6 @@ void RoboTerraTapeSensor::attach(int portID) {
     activate();
 }
 
-bool RoboTerraTapeSensor::readStateMachineFlag() {
-    return stateMachineFlag;
-}
-
 /*********************************************************************
  Note  
  Only the transition from an IR reflective material to a non-
@@ -106,9 +101,9 @@ bool RoboTerraTapeSensor::readStateMachineFlag() {
  bouncing inbetween transition.
 
 *********************************************************************/
-void RoboTerraTapeSensor::runStateMachine() {
+void RoboTerraTapeSensor::runStateMachine(unsigned long nowMillis) {
     if (state == STATE_DEBOUNCE) {
-        if ((millis() - lastDebounceMillis) > DEBOUNCETIME) {
+        if ((nowMillis - lastDebounceMillis) > DEBOUNCETIME) {
             state = (lastLevel == LEVEL_NORMAL) ? STATE_OFFTAPE : STATE_ONTAPE;
         }
     }
@@ -127,7 +122,8 @@ void RoboTerraTapeSensor::runStateMachine() {
                 sendEventMessage(STATE_ONTAPE, BLACK_TAPE_ENTER, count);
                 generateEvent(BLACK_TAPE_ENTER, count);
             }
-            lastDebounceMillis = millis();
+            lastDebounceMillis = nowMillis;
+            sleepUntil(lastDebounceMillis + DEBOUNCETIME + 1); // Nothing to do until debounce ends
         }
     }
 } 
@@ -135,24 +131,10 @@ void RoboTerraTapeSensor::runStateMachine() {
 /************************** Private Class Functions *************************/
 
 void RoboTerraTapeSensor::sendEventMessage(char stateToSend, RoboTerraEventType typeToSend, int firstDataToSend) {
-    uint8_t eventMessageLength = 6 + MSG_LENGTH;
-    uint8_t eventMessage[eventMessageLength]; // EVENT Message
-    
-    eventMessage[0] = 0xF0;                   // EVENT Message Begin
-    eventMessage[1] = 0x01;                   // EVENT Count
-    eventMessage[2] = (uint8_t)DEVICE_ID;     // EVENT Source Device ID
-    eventMessage[3] = (uint8_t)pin;           // EVENT Source Port
-    eventMessage[4] = (uint8_t)MSG_LENGTH;    // Message Length
-    eventMessage[5] = (uint8_t)stateToSend;
-    eventMessage[6] = (uint8_t)typeToSend;
-    eventMessage[7] = (uint8_t)firstDataToSend;
-    eventMessage[8] = (uint8_t)(firstDataToSend >> 8);
-    eventMessage[9] = 0xFF;                  // End marker
-
-    Serial.write(eventMessage, eventMessageLength);
+    encodeEventMessage<MessageFormat>(pin, stateToSend, typeToSend, firstDataToSend);
 }
 
 void RoboTerraTapeSensor::generateEvent(RoboTerraEventType type, int firstData) {
     RoboTerraEvent newEvent(this, type, firstData);
-    sourceEventQueue->enqueue(newEvent);
+    publishEvent(newEvent);
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+/****************************************************************************
+ RoboTerraTimerWheel.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ This is a part of RoboTerra robotics programming framework.
+ A hierarchical timing wheel driving a fixed pool of one-shot and periodic
+ timers. Level 0 has one slot per millisecond, each higher level has one
+ slot per full turn of the level below, so 4 levels of 16 slots cover
+ 65536 ms. A timer is linked into the slot of the lowest level that can
+ hold it, and cascaded down a level when the wheel turns to its slot.
+ Start, stop and expiry are O(1). Longer timers park in the top level and
+ are cascaded until they fit. A periodic timer polled late fires once and
+ skips the periods it missed, counting them, like control loops do.
+
+ ****************************************************************************/
+
+#include <RoboTerraTimerWheel.h>
+
+#define NO_TIMER        0xFF
+#define NO_SLOT         0xFF
+#define EXPIRED_SLOT    (WHEEL_LEVEL_NUM * WHEEL_SLOT_NUM)
+#define SLOT_MASK       (WHEEL_SLOT_NUM - 1)
+#define WHEEL_RANGE     (1UL << (WHEEL_LEVEL_NUM * WHEEL_SLOT_BITS))
+
+#define FLAG_ACTIVE     0x01
+#define FLAG_PERIODIC   0x02
+
+/************************** Class Member Functions *************************/
+
+RoboTerraTimerWheel::RoboTerraTimerWheel() {
+	for (int i = 0; i <= EXPIRED_SLOT; i++) {
+		slotHead[i] = NO_TIMER;
+	}
+	for (int i = 0; i < TIMER_NUM; i++) {
+		timers[i].flags = 0;
+		timers[i].slot = NO_SLOT;
+	}
+	wheelTime = 0;
+	activeNum = 0;
+}
+
+void RoboTerraTimerWheel::start(unsigned char timerID, unsigned long now, unsigned long length, bool isPeriodic) {
+	if (timerID >= TIMER_NUM) {
+		return;
+	}
+	stop(timerID); // Restart if running
+	if (activeNum == 0) {
+		wheelTime = now; // Wheel stood still while no timer ran
+	}
+
+	WheelTimer *timer = &timers[timerID];
+	timer->length = (length == 0) ? 1 : length;
+	timer->expiry = now + timer->length;
+	timer->missedNum = 0;
+	timer->flags = FLAG_ACTIVE | (isPeriodic ? FLAG_PERIODIC : 0);
+	activeNum++;
+	insert(timerID);
+}
+
+void RoboTerraTimerWheel::stop(unsigned char timerID) {
+	if (timerID >= TIMER_NUM || !(timers[timerID].flags & FLAG_ACTIVE)) {
+		return;
+	}
+	unlink(timerID);
+	timers[timerID].flags = 0;
+	activeNum--;
+}
+
+bool RoboTerraTimerWheel::isActive(unsigned char timerID) {
+	return timerID < TIMER_NUM && (timers[timerID].flags & FLAG_ACTIVE);
+}
+
+unsigned long RoboTerraTimerWheel::getLength(unsigned char timerID) {
+	if (timerID >= TIMER_NUM) {
+		return 0;
+	}
+	return timers[timerID].length;
+}
+
+unsigned int RoboTerraTimerWheel::getMissedPeriods(unsigned char timerID) {
+	if (timerID >= TIMER_NUM) {
+		return 0;
+	}
+	return timers[timerID].missedNum;
+}
+
+bool RoboTerraTimerWheel::getNextExpiry(unsigned long &expiry) {
+	bool isFound = false;
+	for (int i = 0; i < TIMER_NUM; i++) {
+		if ((timers[i].flags & FLAG_ACTIVE) && (!isFound || (long)(timers[i].expiry - expiry) < 0)) {
+			expiry = timers[i].expiry;
+			isFound = true;
+		}
+	}
+	return isFound;
+}
+
+bool RoboTerraTimerWheel::poll(unsigned long now, unsigned char &timerID) {
+	if (activeNum == 0) {
+		wheelTime = now;
+		return false;
+	}
+
+	// Turn the wheel one tick at a time until something expires
+	while (slotHead[EXPIRED_SLOT] == NO_TIMER && (long)(now - wheelTime) > 0) {
+		wheelTime++;
+		for (int level = WHEEL_LEVEL_NUM - 1; level > 0; level--) {
+			// Level turns when all bits of levels below are zero
+			if ((wheelTime & ((1UL << (level * WHEEL_SLOT_BITS)) - 1)) == 0) {
+				cascade(level * WHEEL_SLOT_NUM + ((wheelTime >> (level * WHEEL_SLOT_BITS)) & SLOT_MASK));
+			}
+		}
+		cascade(wheelTime & SLOT_MASK); // Level 0 slot, everything in it is due
+	}
+
+	timerID = slotHead[EXPIRED_SLOT];
+	if (timerID == NO_TIMER) {
+		return false;
+	}
+
+	unlink(timerID);
+	WheelTimer *timer = &timers[timerID];
+	if (timer->flags & FLAG_PERIODIC) {
+		timer->expiry += timer->length; // Phase locked to first start
+		while ((long)(now - timer->expiry) >= 0) {
+			timer->expiry += timer->length; // Skip, never fire a burst to catch up
+			if (timer->missedNum != 0xFFFF) {
+				timer->missedNum++;
+			}
+		}
+		insert(timerID);
+	}
+	else {
+		timer->flags = 0;
+		activeNum--;
+	}
+	return true;
+}
+
+/************************** Private Class Functions *************************/
+
+void RoboTerraTimerWheel::insert(unsigned char timerID) {
+	WheelTimer *timer = &timers[timerID];
+	long delta = (long)(timer->expiry - wheelTime);
+	if (delta <= 0) {
+		link(timerID, EXPIRED_SLOT); // Already due, e.g. started with the wheel behind now
+		return;
+	}
+
+	unsigned long slotTime = timer->expiry;
+	if ((unsigned long)delta >= WHEEL_RANGE) {
+		slotTime = wheelTime + WHEEL_RANGE - 1; // Park in top level, cascaded again later
+	}
+	for (int level = 0; level < WHEEL_LEVEL_NUM; level++) {
+		if ((unsigned long)delta < (1UL << ((level + 1) * WHEEL_SLOT_BITS)) || level == WHEEL_LEVEL_NUM - 1) {
+			link(timerID, level * WHEEL_SLOT_NUM + ((slotTime >> (level * WHEEL_SLOT_BITS)) & SLOT_MASK));
+			return;
+		}
+	}
+}
+
+void RoboTerraTimerWheel::link(unsigned char timerID, unsigned char slot) {
+	WheelTimer *timer = &timers[timerID];
+	timer->slot = slot;
+	timer->prev = NO_TIMER;
+	timer->next = slotHead[slot];
+	if (timer->next != NO_TIMER) {
+		timers[timer->next].prev = timerID;
+	}
+	slotHead[slot] = timerID;
+}
+
+void RoboTerraTimerWheel::unlink(unsigned char timerID) {
+	WheelTimer *timer = &timers[timerID];
+	if (timer->slot == NO_SLOT) {
+		return;
+	}
+	if (timer->prev != NO_TIMER) {
+		timers[timer->prev].next = timer->next;
+	}
+	else {
+		slotHead[timer->slot] = timer->next;
+	}
+	if (timer->next != NO_TIMER) {
+		timers[timer->next].prev = timer->prev;
+	}
+	timer->slot = NO_SLOT;
+}
+
+void RoboTerraTimerWheel::cascade(unsigned char slot) {
+	// Re-insert every timer of the slot relative to current wheel time
+	unsigned char timerID = slotHead[slot];
+	slotHead[slot] = NO_TIMER;
+	while (timerID != NO_TIMER) {
+		unsigned char next = timers[timerID].next;
+		insert(timerID);
+		timerID = next;
+	}
+}
\ No newline at end of file
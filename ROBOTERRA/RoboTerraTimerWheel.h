@@ -0,0 +1,66 @@
+/****************************************************************************
+ RoboTerraTimerWheel.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Header file for RoboTerraTimerWheel.cpp
+
+ ****************************************************************************/
+
+#ifndef RoboTerraTimerWheel_h
+#define RoboTerraTimerWheel_h
+
+/************************* Incldued Dependencies ********************/
+
+#include <Arduino.h>
+
+/************************* Defined Constant ********************/
+
+#define TIMER_NUM          4  // Max concurrent timers, no more than 254
+#define WHEEL_LEVEL_NUM    4
+#define WHEEL_SLOT_BITS    4  // 16 slots per level, 1 ms tick at level 0
+#define WHEEL_SLOT_NUM     (1 << WHEEL_SLOT_BITS)
+
+/************************* Actual Class Body ********************/
+
+class RoboTerraTimerWheel {
+
+public:
+	RoboTerraTimerWheel();
+
+	void start(unsigned char timerID, unsigned long now, unsigned long length, bool isPeriodic);
+	void stop(unsigned char timerID);
+	bool isActive(unsigned char timerID);
+	unsigned long getLength(unsigned char timerID);
+	unsigned int getMissedPeriods(unsigned char timerID); // Skipped because poll() was late, saturates
+	bool getNextExpiry(unsigned long &expiry); // False if no timer runs
+
+	// Advance wheel to now, return one expired timer at a time
+	bool poll(unsigned long now, unsigned char &timerID);
+
+private:
+	typedef struct {
+		unsigned long expiry;  // millis() to fire
+		unsigned long length;  // Re-armed by length if periodic
+		unsigned int missedNum;
+		unsigned char flags;
+		unsigned char slot;    // Index in slotHead, NO_SLOT if stopped
+		unsigned char next;    // Doubly linked within a slot, NO_TIMER at ends
+		unsigned char prev;
+	} WheelTimer;
+
+	WheelTimer timers[TIMER_NUM];
+
+	// Level L slot S at index L * WHEEL_SLOT_NUM + S, plus the expired list
+	unsigned char slotHead[WHEEL_LEVEL_NUM * WHEEL_SLOT_NUM + 1];
+
+	unsigned long wheelTime; // Last tick processed
+	unsigned char activeNum;
+
+	void insert(unsigned char timerID);
+	void link(unsigned char timerID, unsigned char slot);
+	void unlink(unsigned char timerID);
+	void cascade(unsigned char slot);
+};
+
+#endif
\ No newline at end of file
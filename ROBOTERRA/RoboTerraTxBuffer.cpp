@@ -0,0 +1,129 @@
+/****************************************************************************
+ RoboTerraTxBuffer.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ This is a part of RoboTerra robotics programming framework.
+ A ring buffer in front of Serial for every frame sent to the app.
+ Serial.write() blocks once the 64 byte TX buffer of HardwareSerial is
+ full, so frames are queued here whole and handed to Serial only as far
+ as Serial.availableForWrite() allows. HardwareSerial keeps sending them
+ from its data register empty interrupt.
+
+ When a frame does not fit it is dropped whole, the app never sees half
+ a frame. TX_PRIORITY_LOW frames, the diagnostic reports, are dropped 
+ while less than TX_REPORT_HEADROOM bytes would stay free for EVENTs. A 
+ frame larger than the whole buffer, e.g. a long print message, would 
+ never fit, so it is written to Serial directly after the queued frames.
+
+ Each frame is queued after a byte holding its length, which tells where
+ it ends. A frame written from an interrupt, the stall report, first 
+ completes the frame pump() left partly handed to Serial.
+
+ ****************************************************************************/
+
+#include <RoboTerraTxBuffer.h>
+
+#define BUFFER_MASK (TX_BUFFER_SIZE - 1)
+
+/************************** Class Member Functions *************************/ 
+
+RoboTerraTxBuffer::RoboTerraTxBuffer() {
+	head = 0;
+	length = 0;
+	frameLeft = 0;
+	dropCount = 0;
+	highWaterMark = 0;
+}
+
+bool RoboTerraTxBuffer::write(const uint8_t *frame, unsigned int frameLength, RoboTerraTxPriority priority) {
+	if (frameLength + 1 > TX_BUFFER_SIZE) {
+		handOver(length); // Blocks, frames keep their order
+		Serial.write(frame, frameLength);
+		return true;
+	}
+
+	pump(); // Make room first
+
+	if (!hasRoom(frameLength, priority)) {
+		if (dropCount != 0xFFFF) {
+			dropCount++;
+		}
+		return false;
+	}
+
+	unsigned int tail = (head + length) & BUFFER_MASK;
+	buffer[tail] = (uint8_t)frameLength;
+	tail = (tail + 1) & BUFFER_MASK;
+	for (unsigned int i = 0; i < frameLength; i++) {
+		buffer[tail] = frame[i];
+		tail = (tail + 1) & BUFFER_MASK;
+	}
+	length += frameLength + 1;
+	if (length > highWaterMark) {
+		highWaterMark = length;
+	}
+
+	pump(); // Start sending right away if Serial is idle
+	return true;
+}
+
+void RoboTerraTxBuffer::pump() {
+	int room = Serial.availableForWrite();
+	if (room > 0) {
+		handOver(room);
+	}
+}
+
+void RoboTerraTxBuffer::finishFrame() {
+	handOver(frameLeft); // Serial.write() blocks until the UART takes the rest
+}
+
+bool RoboTerraTxBuffer::hasRoom(unsigned int frameLength, RoboTerraTxPriority priority) {
+	unsigned int room = TX_BUFFER_SIZE - length;
+	if (priority == TX_PRIORITY_LOW) {
+		room = (room > TX_REPORT_HEADROOM) ? room - TX_REPORT_HEADROOM : 0;
+	}
+	return frameLength + 1 <= room; // Length byte included
+}
+
+bool RoboTerraTxBuffer::isEmpty() {
+	return length == 0;
+}
+
+unsigned int RoboTerraTxBuffer::getDropCount() {
+	return dropCount;
+}
+
+unsigned int RoboTerraTxBuffer::getHighWaterMark() {
+	return highWaterMark;
+}
+
+/************************** Private Class Functions *************************/
+
+void RoboTerraTxBuffer::handOver(unsigned int byteNum) {
+	while (byteNum > 0 && length > 0) {
+		if (frameLeft == 0) {
+			frameLeft = buffer[head]; // Next frame begins
+			head = (head + 1) & BUFFER_MASK;
+			length--;
+		}
+
+		// Bytes up to the end of buffer or of frame in one call
+		unsigned int chunk = TX_BUFFER_SIZE - head;
+		if (chunk > frameLeft) {
+			chunk = frameLeft;
+		}
+		if (chunk > byteNum) {
+			chunk = byteNum;
+		}
+		Serial.write(&buffer[head], chunk);
+		head = (head + chunk) & BUFFER_MASK;
+		length -= chunk;
+		frameLeft -= chunk;
+		byteNum -= chunk;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+/****************************************************************************
+ RoboTerraTxBuffer.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Header file for RoboTerraTxBuffer.cpp
+
+ ****************************************************************************/
+
+#ifndef RoboTerraTxBuffer_h
+#define RoboTerraTxBuffer_h
+
+/************************* Incldued Dependencies ********************/
+
+#include <Arduino.h>
+#include <RoboTerraShareData.h>
+
+/************************* Defined Constant ********************/
+
+#define TX_BUFFER_SIZE     64  // Must be a power of two, on top of 64 bytes of Serial
+#define TX_REPORT_HEADROOM 16  // Bytes TX_PRIORITY_LOW frames leave free, a 43 byte report still fits
+
+/************************* Actual Class Body ********************/
+
+class RoboTerraTxBuffer {
+
+public:
+	RoboTerraTxBuffer();
+
+	// Queue a whole frame or drop it, only a frame larger than the buffer blocks
+	bool write(const uint8_t *frame, unsigned int frameLength, RoboTerraTxPriority priority);
+
+	// Called by Kernal Loop, hand bytes to Serial as far as it takes them without blocking
+	void pump();
+
+	// Called by RoboTerraLoopMonitor::reportStall(), blocks until the frame pump() 
+	// has partly handed to Serial is complete, so another frame can follow
+	void finishFrame();
+
+	bool hasRoom(unsigned int frameLength, RoboTerraTxPriority priority);
+	bool isEmpty();
+	unsigned int getDropCount();
+	unsigned int getHighWaterMark();
+
+private:
+	uint8_t buffer[TX_BUFFER_SIZE]; // Each frame preceded by its length, which is not sent
+	unsigned int head;   // Next byte to send
+	unsigned int length; // Bytes queued
+	unsigned int frameLeft; // Bytes of the frame at head not yet handed to Serial, 0 at a frame boundary
+	unsigned int dropCount; // Frames lost because buffer was full
+	unsigned int highWaterMark;
+
+	void handOver(unsigned int byteNum);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+/****************************************************************************
+ RoboTerraCommandEncoder.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Host side builder of the command frames RoboCore reads from the app.
+ 	Not compiled into the sketch.
+
+ 	0xFA, Length, Command, Port, data 0 (2 bytes), data 1 (2 bytes), 0xFF
+
+ 	Length counts Command, Port and data, data is little endian. Command
+ 	is a RoboTerraCommandType, Port the RoboCorePortID of the electronics
+ 	or 0 for RoboCore itself.
+
+ ****************************************************************************/
+
+#ifndef RoboTerraCommandEncoder_h
+#define RoboTerraCommandEncoder_h
+
+/************************* Incldued Dependencies ********************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../../RoboTerraShareData.h" // RoboTerraCommandType shared with RoboCore
+
+/************************* Defined Constant ********************/
+
+#define COMMAND_BEGIN        0xFA
+#define COMMAND_END          0xFF
+#define COMMAND_FRAME_MAX    9
+
+/************************* Actual Class Body ********************/
+
+// Writes a frame of dataNum (0 - 2) data to frame, returns its length
+inline size_t encodeRoboTerraCommand(uint8_t *frame, RoboTerraCommandType command, uint8_t port, int dataNum, int16_t firstData = 0, int16_t secondData = 0) {
+    size_t length = 0;
+    frame[length++] = COMMAND_BEGIN;
+    frame[length++] = (uint8_t)(2 + 2 * dataNum);
+    frame[length++] = (uint8_t)command;
+    frame[length++] = port;
+    int16_t data[2] = { firstData, secondData };
+    for (int i = 0; i < dataNum; i++) {
+        frame[length++] = (uint8_t)data[i];
+        frame[length++] = (uint8_t)((uint16_t)data[i] >> 8);
+    }
+    frame[length++] = COMMAND_END;
+    return length;
+}
+
+#endif
\ No newline at end of file
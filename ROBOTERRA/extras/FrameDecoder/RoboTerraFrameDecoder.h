@@ -0,0 +1,302 @@
+/****************************************************************************
+ RoboTerraFrameDecoder.h
+ 	Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Description
+ 	Host side parser of the serial frames RoboCore sends to the app.
+ 	Not compiled into the sketch. Feed it received bytes in chunks of any
+ 	size, it calls back once per EVENT and once per other frame.
+
+ 	0xF0, EVENT count, { Device ID, Port, Message Length, State, Type,
+ 	data 0 (2 bytes), data 1 (2 bytes, optional) } x count, 0xFF
+ 	RoboCore (Device ID 1) sends ROBOCORE_TIME_UP with data 1, the timerID.
+
+ 	0xF1 - 0xF6, Length, payload of Length bytes, 0xFF
+
+ 	0xF7, varint millis since last compact frame, records, 0xFF
+ 	0xF8, 4 byte millis, records, 0xFF
+ 	where a compact record is State << 5 | source index, Type,
+ 	varint (zigzag data 0 << 1 | 1 if data 1 follows), varint zigzag data 1,
+ 	and 0xFE, source index, Device ID, Port enters a source before its first
+ 	record. 0xF8 is a key frame, sources entered before it are forgotten.
+ 	0xF6, 1, wire format, 0xFF announces the format RoboCore switched to.
+
+ 	Bytes that do not make a valid frame are skipped and counted.
+
+ ****************************************************************************/
+
+#ifndef RoboTerraFrameDecoder_h
+#define RoboTerraFrameDecoder_h
+
+/************************* Incldued Dependencies ********************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/************************* Defined Constant ********************/
+
+#define FRAME_EVENT            0xF0
+#define FRAME_PRINT            0xF1
+#define FRAME_WIRE_FORMAT      0xF6
+#define FRAME_COMPACT_DELTA    0xF7
+#define FRAME_COMPACT_ABSOLUTE 0xF8
+#define FRAME_LAST_MARKER      0xF8
+#define FRAME_END              0xFF
+#define COMPACT_SOURCE_ENTRY   0xFE
+#define COMPACT_SOURCE_NUM     32
+#define COMPACT_SOURCE_LIMIT   30 // Index in 5 bits, never makes 0xFE or 0xFF
+#define ROBOCORE_DEVICE_ID     1
+#define COMPACT_FRAME_MAX      35 // EVENT_FRAME_SIZE + 3, the frame buffer of RoboTerraEventSource.h
+
+/************************* Actual Class Body ********************/
+
+struct RoboTerraWireEvent {
+    uint8_t deviceID;
+    uint8_t port;
+    uint8_t state;
+    uint8_t type;    // RoboTerraEventType
+    uint8_t dataNum; // 1 or 2
+    int16_t data[2];
+    uint8_t sourceIndex;    // Compact frames only, 0 otherwise
+    bool hasTime;           // Compact frames only
+    unsigned long timeMillis; // RoboCore millis() of the pass that sent it
+};
+
+class RoboTerraFrameDecoder {
+
+public:
+    typedef void (*EventCallback)(const RoboTerraWireEvent &event, void *context);
+    typedef void (*FrameCallback)(uint8_t marker, const uint8_t *payload, uint8_t length, void *context);
+
+    RoboTerraFrameDecoder(EventCallback eventCallback, FrameCallback frameCallback, void *callbackContext)
+        : onEvent(eventCallback), onFrame(frameCallback), context(callbackContext), skippedBytes(0), frameMillis(0), isTimeKnown(false) {
+        forgetSources();
+    }
+
+    void feed(const uint8_t *bytes, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            frame.push_back(bytes[i]);
+            parse();
+        }
+    }
+
+    unsigned long getSkippedBytes() const { return skippedBytes; }
+
+private:
+    EventCallback onEvent;
+    FrameCallback onFrame;
+    void *context;
+    unsigned long skippedBytes;
+    std::vector<uint8_t> frame; // Bytes from a begin marker on
+
+    // What compact frames refer to instead of repeating
+    uint8_t sourceDevice[COMPACT_SOURCE_NUM];
+    uint8_t sourcePort[COMPACT_SOURCE_NUM];
+    unsigned long frameMillis;
+    bool isTimeKnown;
+
+    void parse() {
+        while (!frame.empty()) {
+            if (frame[0] < FRAME_EVENT || frame[0] > FRAME_LAST_MARKER) {
+                skip(); // Not a begin marker
+                continue;
+            }
+            size_t frameLength;
+            if (!measure(frameLength)) {
+                skip();
+                continue;
+            }
+            if (frameLength == 0 || frame.size() < frameLength) {
+                return; // Wait for more bytes
+            }
+            if (frame[frameLength - 1] != FRAME_END) {
+                skip();
+                continue;
+            }
+            deliver();
+            frame.erase(frame.begin(), frame.begin() + frameLength);
+        }
+    }
+
+    // Length of frame at front, 0 if not known yet, false if malformed
+    bool measure(size_t &frameLength) {
+        frameLength = 0;
+        if (frame.size() < 2) {
+            return true;
+        }
+        if (frame[0] == FRAME_COMPACT_DELTA || frame[0] == FRAME_COMPACT_ABSOLUTE) {
+            return measureCompact(frameLength);
+        }
+        if (frame[0] != FRAME_EVENT) {
+            frameLength = 3 + frame[1];
+            return true;
+        }
+        if (frame[1] == 0) {
+            return false;
+        }
+        size_t position = 2;
+        for (int i = 0; i < frame[1]; i++) {
+            if (frame.size() < position + 3) {
+                return true;
+            }
+            uint8_t messageLength = frame[position + 2];
+            if (messageLength < 4) {
+                return false; // State, Type and data 0 at least
+            }
+            position += 3 + messageLength;
+        }
+        frameLength = position + 1;
+        return true;
+    }
+
+    // Compact records delimit themselves, walk them up to the end marker
+    bool measureCompact(size_t &frameLength) {
+        size_t position = 1;
+        unsigned long value;
+        if (frame[0] == FRAME_COMPACT_ABSOLUTE) {
+            position += 4;
+        }
+        else if (!readVarint(position, value)) {
+            return frame.size() < COMPACT_FRAME_MAX;
+        }
+        while (true) {
+            if (position >= COMPACT_FRAME_MAX) {
+                return false;
+            }
+            if (position >= frame.size()) {
+                return true;
+            }
+            uint8_t head = frame[position];
+            if (head == FRAME_END) {
+                frameLength = position + 1;
+                return true;
+            }
+            if (head == COMPACT_SOURCE_ENTRY) {
+                position += 4;
+                continue;
+            }
+            if ((head & 0x1F) >= COMPACT_SOURCE_LIMIT) {
+                return false; // Source index out of range
+            }
+            position += 2;
+            if (!readVarint(position, value)) {
+                return frame.size() < COMPACT_FRAME_MAX;
+            }
+            if ((value & 1) && !readVarint(position, value)) {
+                return frame.size() < COMPACT_FRAME_MAX;
+            }
+        }
+    }
+
+    // False if the varint at position is not complete yet
+    bool readVarint(size_t &position, unsigned long &value) {
+        value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (position >= frame.size()) {
+                return false;
+            }
+            uint8_t byte = frame[position++];
+            value |= (unsigned long)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static int16_t unzigzag(unsigned long value) {
+        return (int16_t)((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    void forgetSources() {
+        for (int i = 0; i < COMPACT_SOURCE_NUM; i++) {
+            sourceDevice[i] = 0;
+            sourcePort[i] = 0;
+        }
+    }
+
+    void deliverCompact() {
+        size_t position = 1;
+        unsigned long value;
+        if (frame[0] == FRAME_COMPACT_ABSOLUTE) {
+            forgetSources();
+            frameMillis = frame[1] | (frame[2] << 8) | ((unsigned long)frame[3] << 16) | ((unsigned long)frame[4] << 24);
+            isTimeKnown = true;
+            position += 4;
+        }
+        else {
+            readVarint(position, value);
+            frameMillis += value;
+        }
+
+        while (frame[position] != FRAME_END) {
+            if (frame[position] == COMPACT_SOURCE_ENTRY) {
+                uint8_t index = frame[position + 1] & 0x1F;
+                sourceDevice[index] = frame[position + 2];
+                sourcePort[index] = frame[position + 3];
+                position += 4;
+                continue;
+            }
+            RoboTerraWireEvent event;
+            event.sourceIndex = frame[position] & 0x1F;
+            event.state = frame[position] >> 5;
+            event.type = frame[position + 1];
+            event.deviceID = sourceDevice[event.sourceIndex];
+            event.port = sourcePort[event.sourceIndex];
+            position += 2;
+            readVarint(position, value);
+            event.dataNum = (value & 1) ? 2 : 1;
+            event.data[0] = unzigzag(value >> 1);
+            event.data[1] = 0;
+            if (event.dataNum == 2) {
+                readVarint(position, value);
+                event.data[1] = unzigzag(value);
+            }
+            event.hasTime = isTimeKnown;
+            event.timeMillis = frameMillis;
+            if (onEvent != NULL) {
+                onEvent(event, context);
+            }
+        }
+    }
+
+    void deliver() {
+        if (frame[0] == FRAME_COMPACT_DELTA || frame[0] == FRAME_COMPACT_ABSOLUTE) {
+            deliverCompact();
+            return;
+        }
+        if (frame[0] != FRAME_EVENT) {
+            if (onFrame != NULL) {
+                onFrame(frame[0], &frame[2], frame[1], context);
+            }
+            return;
+        }
+        size_t position = 2;
+        for (int i = 0; i < frame[1]; i++) {
+            const uint8_t *record = &frame[position];
+            RoboTerraWireEvent event;
+            event.deviceID = record[0];
+            event.port = record[1];
+            event.state = record[3];
+            event.type = record[4];
+            event.dataNum = (record[2] >= 6) ? 2 : 1;
+            event.data[0] = (int16_t)(record[5] | (record[6] << 8));
+            event.data[1] = (event.dataNum == 2) ? (int16_t)(record[7] | (record[8] << 8)) : 0;
+            event.sourceIndex = 0;
+            event.hasTime = false;
+            event.timeMillis = 0;
+            if (onEvent != NULL) {
+                onEvent(event, context);
+            }
+            position += 3 + record[2];
+        }
+    }
+
+    void skip() {
+        frame.erase(frame.begin());
+        skippedBytes++;
+    }
+};
+
+#endif
\ No newline at end of file
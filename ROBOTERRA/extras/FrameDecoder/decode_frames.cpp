@@ -0,0 +1,61 @@
+/****************************************************************************
+ decode_frames.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ Host tool printing the frames of a RoboCore serial capture, one EVENT
+ or frame per line, e.g.
+
+ 	stty -F /dev/ttyACM0 115200 raw && ./decode_frames < /dev/ttyACM0
+
+ Build with any C++11 compiler: c++ -std=c++11 -o decode_frames decode_frames.cpp
+
+ ****************************************************************************/
+
+#include <stdio.h>
+#include "RoboTerraFrameDecoder.h"
+#include "../../RoboTerraShareData.h"
+
+static void printEvent(const RoboTerraWireEvent &event, void *) {
+    if (event.hasTime) {
+        printf("%lu ms ", event.timeMillis);
+    }
+    if (event.deviceID == ROBOCORE_DEVICE_ID && event.type == ROBOCORE_TIME_UP && event.dataNum == 2) {
+        printf("TIME_UP timer %d length %d\n", event.data[1], event.data[0]);
+    }
+    else if (event.dataNum == 2) {
+        printf("EVENT device %u port %u state %u type %u data %d %d\n", event.deviceID, event.port, event.state, event.type, event.data[0], event.data[1]);
+    }
+    else {
+        printf("EVENT device %u port %u state %u type %u data %d\n", event.deviceID, event.port, event.state, event.type, event.data[0]);
+    }
+}
+
+static void printFrame(uint8_t marker, const uint8_t *payload, uint8_t length, void *) {
+    if (marker == FRAME_PRINT) {
+        printf("PRINT %.*s\n", (int)length, (const char *)payload);
+        return;
+    }
+    printf("FRAME 0x%02X", marker);
+    for (int i = 0; i < length; i++) {
+        printf(" %02X", payload[i]);
+    }
+    printf("\n");
+}
+
+int main() {
+    RoboTerraFrameDecoder decoder(printEvent, printFrame, NULL);
+    uint8_t buffer[256];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+        decoder.feed(buffer, length);
+        fflush(stdout);
+    }
+    if (decoder.getSkippedBytes() > 0) {
+        fprintf(stderr, "%lu bytes skipped\n", decoder.getSkippedBytes());
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+/****************************************************************************
+ send_command.cpp
+ Copyright (c) 2015 ROBOTERRA, Inc. All rights reserved.
+
+ Current Revision
+ 1.0
+
+ Description
+ Host tool writing one command frame for RoboCore to stdout, e.g. a
+ servo on SERVO_A (port 10) to 90 degrees at speed 5
+
+ 	./send_command 30 10 90 5 > /dev/ttyACM0
+
+ Build with any C++11 compiler: c++ -std=c++11 -o send_command send_command.cpp
+
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "RoboTerraCommandEncoder.h"
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 5) {
+        fprintf(stderr, "usage: %s command port [data 0 [data 1]]\n", argv[0]);
+        return 1;
+    }
+    uint8_t frame[COMMAND_FRAME_MAX];
+    int dataNum = argc - 3;
+    size_t length = encodeRoboTerraCommand(frame, (RoboTerraCommandType)atoi(argv[1]), (uint8_t)atoi(argv[2]), dataNum,
+                                           (int16_t)(dataNum > 0 ? atoi(argv[3]) : 0), (int16_t)(dataNum > 1 ? atoi(argv[4]) : 0));
+    fwrite(frame, 1, length, stdout);
+    return 0;
+}
\ No newline at end of file
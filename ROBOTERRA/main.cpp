@@ -16,20 +16,33 @@ int main(void) {
 	ROBOT.getRobotController()->launch();
 
 	// Kernal Loop
+	RoboTerraEvent eventBatch[EVENT_BATCH_SIZE]; // Drained together
+	int eventNum;
 	for (;;) {
+		ROBOT.getRobotController()->sampleLoopTime(); // Shared by whole pass
+		ROBOT.getRobotController()->runControlLoops(); // First for least jitter
 		
-		ROBOT.getRobotController()->handleRoboCoreEvents();
+		ROBOT.getRobotController()->handleInterruptEvents();
+		ROBOT.getRobotController()->handleCommands(); // Sent by app
 		ROBOT.getRobotController()->runPeripheralStateMachines();
-		ROBOT.getRobotController()->handlePeripheralEvents();
 		ROBOT.getRobotController()->checkRoboCoreTimer();
+		ROBOT.getRobotController()->checkQueueReport();
 		
-		while (ROBOT.getEventQueue()->isEmpty() == false) {
-			EVENT = ROBOT.getEventQueue()->dequeue();
-			handleRoboTerraEvent(); // Writen by client
+		while ((eventNum = ROBOT.getEventQueue()->dequeue(eventBatch, EVENT_BATCH_SIZE)) > 0) {
+			for (int i = 0; i < eventNum; i++) {
+				EVENT = eventBatch[i];
+				LOOP_STEP(STAGE_EVENT_HANDLER, EVENT.getSourceIndex());
+				ROBOT.dispatch(EVENT); // Handlers subscribed by client
+				handleRoboTerraEvent(); // Writen by client
+			}
 		}
+		LOOP_STEP(STAGE_KERNAL, 0);
+		ROBOT.getRobotController()->flushEventMessages();
 		
 		// USB Program event
 		if (serialEventRun) serialEventRun();
+
+		ROBOT.getRobotController()->idle(); // Nothing due, wait for an interrupt
 	}
 	return 0;
 }
\ No newline at end of file